@@ -6,14 +6,23 @@
 #include <X11/Xatom.h>
 #include <X11/cursorfont.h>
 #include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
 #include <X11/extensions/XInput2.h>
 #include <X11/extensions/Xrandr.h>
 #include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xpresent.h>
+#include <X11/extensions/XShm.h>
 #include <cairo/cairo.h>
 #include <cairo/cairo-xlib.h>
 #include <dbus/dbus.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 #include <execinfo.h>
 #include <limits.h>
 #include <stdio.h>
@@ -48,6 +57,10 @@
 #include "ewmh/client_list.h"
 #include "ewmh/active_window.h"
 #include "portals/portals.h"
+#include "portals/lookup.h"
+#include "portals/stacking.h"
+#include "portals/spatial.h"
+#include "compositor/damage.h"
 #include "compositor/shadow.h"
 #include "compositor/border.h"
 #include "portals/frames.h"
@@ -61,3 +74,11 @@
 #include "events/events.h"
 #include "events/handlers.h"
 #include "events/xinput.h"
+#include "events/devices.h"
+#include "events/damage.h"
+#include "events/present.h"
+#include "events/pointer.h"
+#include "events/coalesce.h"
+#include "diagnostics/latency.h"
+#include "diagnostics/trace.h"
+#include "diagnostics/rendering.h"
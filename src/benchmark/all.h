@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../all.h"
+
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <math.h>
+
+#include "session.h"
+#include "clients.h"
+#include "gestures.h"
@@ -0,0 +1,160 @@
+/**
+ * This code is responsible for the synthetic clients of the benchmark.
+ *
+ * Every client is a plain window which is repainted entirely at a fixed rate,
+ * so the compositor has to redraw it on every frame. Every other client uses
+ * a 32-bit ARGB visual, so the compositor also has to blend, while the others
+ * use the default RGB visual.
+ */
+
+#include "all.h"
+
+/** The width of a client window in pixels. */
+#define CLIENT_WIDTH 320
+
+/** The height of a client window in pixels. */
+#define CLIENT_HEIGHT 240
+
+/** The opacity of ARGB client windows, out of 255. */
+#define CLIENT_ALPHA 0xC0
+
+void initialize_benchmark_clients(BenchmarkClients *clients, Display *display)
+{
+    Window root_window = DefaultRootWindow(display);
+
+    *clients = (BenchmarkClients){
+        .display = display,
+        .clients = NULL,
+        .count = 0,
+        .capacity = 0,
+        .argb_visual = NULL,
+        .argb_colormap = None,
+        .rgb_gc = XCreateGC(display, root_window, 0, NULL),
+        .argb_gc = NULL,
+        .repaint_count = 0
+    };
+
+    // Find a 32-bit visual for the ARGB clients.
+    XVisualInfo visual_info;
+    if (!XMatchVisualInfo(display, DefaultScreen(display), 32, TrueColor, &visual_info))
+    {
+        LOG_WARNING("No 32-bit visual available, all clients will be RGB.");
+        return;
+    }
+    clients->argb_visual = visual_info.visual;
+    clients->argb_colormap = XCreateColormap(display, root_window, visual_info.visual, AllocNone);
+
+    // Graphics contexts are bound to a depth, so create the one of the ARGB
+    // clients on a drawable of theirs.
+    Pixmap pixmap = XCreatePixmap(display, root_window, 1, 1, 32);
+    clients->argb_gc = XCreateGC(display, pixmap, 0, NULL);
+    XFreePixmap(display, pixmap);
+}
+
+static Window create_client_window(BenchmarkClients *clients, unsigned int index, bool argb)
+{
+    Display *display = clients->display;
+
+    // Cascade the windows across the screen, so they overlap partially.
+    int x = 40 + (int)((index * 23) % 1200);
+    int y = 40 + (int)((index * 17) % 600);
+
+    XSetWindowAttributes attributes = {
+        .background_pixel = 0,
+        .border_pixel = 0,
+        .colormap = argb ? clients->argb_colormap : None
+    };
+    Window window = XCreateWindow(
+        display,
+        DefaultRootWindow(display),
+        x, y,
+        CLIENT_WIDTH, CLIENT_HEIGHT,
+        0,
+        argb ? 32 : CopyFromParent,
+        InputOutput,
+        argb ? clients->argb_visual : CopyFromParent,
+        CWBackPixel | CWBorderPixel | (argb ? CWColormap : 0),
+        &attributes
+    );
+
+    char name[64];
+    snprintf(name, sizeof(name), "Benchmark client %u (%s)", index + 1, argb ? "ARGB" : "RGB");
+    XStoreName(display, window, name);
+    XMapWindow(display, window);
+
+    return window;
+}
+
+int add_benchmark_clients(BenchmarkClients *clients, unsigned int count)
+{
+    if (count <= clients->count) return 0;
+
+    // Grow the client array, if necessary.
+    if (count > clients->capacity)
+    {
+        BenchmarkClient *new_clients = realloc(clients->clients, count * sizeof(BenchmarkClient));
+        if (new_clients == NULL)
+        {
+            LOG_ERROR("Could not add clients, memory allocation failed.");
+            return -1;
+        }
+        clients->clients = new_clients;
+        clients->capacity = count;
+    }
+
+    for (unsigned int i = clients->count; i < count; i++)
+    {
+        bool argb = (i % 2 == 1) && clients->argb_visual != NULL;
+        clients->clients[i] = (BenchmarkClient){
+            .window = create_client_window(clients, i, argb),
+            .argb = argb
+        };
+    }
+    clients->count = count;
+
+    XFlush(clients->display);
+    return 0;
+}
+
+void repaint_benchmark_clients(BenchmarkClients *clients)
+{
+    Display *display = clients->display;
+
+    for (unsigned int i = 0; i < clients->count; i++)
+    {
+        BenchmarkClient *client = &clients->clients[i];
+
+        // Cycle through the colors, offset per client.
+        unsigned long shade = (clients->repaint_count * 8 + i * 37) & 0xFF;
+        unsigned long red = shade, green = 0x80, blue = 0xFF - shade;
+
+        // ARGB pixels are premultiplied by their alpha.
+        unsigned long pixel;
+        GC gc;
+        if (client->argb)
+        {
+            red = red * CLIENT_ALPHA / 0xFF;
+            green = green * CLIENT_ALPHA / 0xFF;
+            blue = blue * CLIENT_ALPHA / 0xFF;
+            pixel = ((unsigned long)CLIENT_ALPHA << 24) | (red << 16) | (green << 8) | blue;
+            gc = clients->argb_gc;
+        }
+        else
+        {
+            pixel = (red << 16) | (green << 8) | blue;
+            gc = clients->rgb_gc;
+        }
+
+        XSetForeground(display, gc, pixel);
+        XFillRectangle(display, client->window, gc, 0, 0, CLIENT_WIDTH, CLIENT_HEIGHT);
+    }
+
+    clients->repaint_count++;
+}
+
+Window get_top_benchmark_client(BenchmarkClients *clients)
+{
+    if (clients->count == 0) return None;
+
+    return clients->clients[clients->count - 1].window;
+}
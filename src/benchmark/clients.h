@@ -0,0 +1,68 @@
+#pragma once
+#include "all.h"
+
+/**
+ * A synthetic client window.
+ */
+typedef struct {
+    Window window;
+    bool argb;
+} BenchmarkClient;
+
+/**
+ * The synthetic clients of the benchmark, along with the resources used to
+ * repaint them.
+ */
+typedef struct {
+    Display *display;
+    BenchmarkClient *clients;
+    unsigned int count;
+    unsigned int capacity;
+    Visual *argb_visual;
+    Colormap argb_colormap;
+    GC rgb_gc;
+    GC argb_gc;
+    unsigned long repaint_count;
+} BenchmarkClients;
+
+/**
+ * Prepares the resources used to create and repaint synthetic clients.
+ *
+ * @param clients The clients to initialize.
+ * @param display The display to create the clients on.
+ *
+ * @note Without a 32-bit visual, all clients use the default RGB visual.
+ */
+void initialize_benchmark_clients(BenchmarkClients *clients, Display *display);
+
+/**
+ * Creates and maps synthetic clients until there are as many as requested.
+ *
+ * @param clients The clients to add to.
+ * @param count The total number of clients.
+ *
+ * @return - `0` The clients were created.
+ * @return - `-1` The clients could not be allocated.
+ *
+ * @note Clients are never removed, so counts lower than the current one have
+ * no effect.
+ */
+int add_benchmark_clients(BenchmarkClients *clients, unsigned int count);
+
+/**
+ * Repaints all synthetic clients entirely, with a color that changes on every
+ * repaint.
+ *
+ * @param clients The clients to repaint.
+ */
+void repaint_benchmark_clients(BenchmarkClients *clients);
+
+/**
+ * Retrieves the synthetic client mapped last, which is on top of the others.
+ *
+ * @param clients The clients to search.
+ *
+ * @return - `Window` The window of the client.
+ * @return - `None` No client was created.
+ */
+Window get_top_benchmark_client(BenchmarkClients *clients);
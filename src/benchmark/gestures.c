@@ -0,0 +1,96 @@
+/**
+ * This code is responsible for the scripted gestures of the benchmark.
+ *
+ * Gestures are performed through XTest, so the window manager handles them as
+ * real pointer input. A drag grabs a portal by its title bar and moves it
+ * along a circle, and a resize grabs it by its bottom-right corner and grows
+ * and shrinks it. Gestures advance one step per repaint of the clients.
+ */
+
+#include "all.h"
+
+/** The number of pointer motions per gesture. */
+#define GESTURE_STEP_COUNT 120
+
+/** The radius of the circle portals are dragged along, in pixels. */
+#define DRAG_RADIUS 120
+
+/** How far portals are grown while resized, in pixels. */
+#define RESIZE_EXTENT 160
+
+static bool get_portal_geometry(Display *display, Window client_window,
+    int *out_x, int *out_y, unsigned int *out_width, unsigned int *out_height)
+{
+    // Find the frame window the client was reparented into.
+    Window root_window, frame_window, *children = NULL;
+    unsigned int child_count;
+    if (!XQueryTree(display, client_window, &root_window, &frame_window, &children, &child_count))
+    {
+        return false;
+    }
+    if (children != NULL) XFree(children);
+    if (frame_window == root_window) return false;
+
+    // Frames are children of root, so their position is relative to root.
+    unsigned int border_width, depth;
+    return XGetGeometry(display, frame_window, &root_window,
+        out_x, out_y, out_width, out_height, &border_width, &depth);
+}
+
+bool begin_benchmark_gesture(BenchmarkGesture *gesture, Display *display, Window client_window, GestureKind kind)
+{
+    int x, y;
+    unsigned int width, height;
+    if (!get_portal_geometry(display, client_window, &x, &y, &width, &height)) return false;
+
+    // Grab the portal by the title bar, left of the triggers, or just inside
+    // the resize area.
+    *gesture = (BenchmarkGesture){
+        .kind = kind,
+        .active = true,
+        .start_x = kind == GESTURE_DRAG ? x + 24 : x + (int)width - 3,
+        .start_y = kind == GESTURE_DRAG ? y + PORTAL_TITLE_BAR_HEIGHT / 2 : y + (int)height - 3,
+        .step = 0
+    };
+
+    XTestFakeMotionEvent(display, -1, gesture->start_x, gesture->start_y, CurrentTime);
+    XTestFakeButtonEvent(display, Button1, True, CurrentTime);
+    return true;
+}
+
+bool advance_benchmark_gesture(BenchmarkGesture *gesture, Display *display)
+{
+    if (!gesture->active) return false;
+
+    gesture->step++;
+    double progress = (double)gesture->step / GESTURE_STEP_COUNT;
+
+    // Determine the pointer position of the step.
+    int x, y;
+    if (gesture->kind == GESTURE_DRAG)
+    {
+        double angle = progress * 2 * M_PI;
+        x = gesture->start_x + (int)(DRAG_RADIUS * (1 - cos(angle)));
+        y = gesture->start_y + (int)(DRAG_RADIUS * sin(angle));
+    }
+    else
+    {
+        int extent = (int)(RESIZE_EXTENT * sin(progress * M_PI));
+        x = gesture->start_x + extent;
+        y = gesture->start_y + extent;
+    }
+    XTestFakeMotionEvent(display, -1, x, y, CurrentTime);
+
+    if (gesture->step < GESTURE_STEP_COUNT) return true;
+
+    end_benchmark_gesture(gesture, display);
+    return false;
+}
+
+void end_benchmark_gesture(BenchmarkGesture *gesture, Display *display)
+{
+    if (!gesture->active) return;
+
+    XTestFakeButtonEvent(display, Button1, False, CurrentTime);
+    gesture->active = false;
+}
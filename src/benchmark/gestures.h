@@ -0,0 +1,52 @@
+#pragma once
+#include "all.h"
+
+/** The kinds of pointer gestures performed on portals. */
+typedef enum {
+    GESTURE_DRAG,
+    GESTURE_RESIZE
+} GestureKind;
+
+/**
+ * A pointer gesture in progress, performed one step at a time.
+ */
+typedef struct {
+    GestureKind kind;
+    bool active;
+    int start_x, start_y;
+    int step;
+} BenchmarkGesture;
+
+/**
+ * Presses the pointer button on the portal of a client window, where the
+ * gesture starts.
+ *
+ * @param gesture The gesture to begin.
+ * @param display The display to send the input to.
+ * @param client_window The client window whose portal is the target.
+ * @param kind The kind of gesture.
+ *
+ * @return - `true` The gesture was begun.
+ * @return - `false` The client window isn't framed by a portal yet.
+ */
+bool begin_benchmark_gesture(BenchmarkGesture *gesture, Display *display, Window client_window, GestureKind kind);
+
+/**
+ * Moves the pointer by one step of a gesture, and releases the pointer button
+ * after the last step.
+ *
+ * @param gesture The gesture to advance.
+ * @param display The display to send the input to.
+ *
+ * @return - `true` The gesture continues.
+ * @return - `false` The gesture has ended.
+ */
+bool advance_benchmark_gesture(BenchmarkGesture *gesture, Display *display);
+
+/**
+ * Releases the pointer button of a gesture, if it's still in progress.
+ *
+ * @param gesture The gesture to end.
+ * @param display The display to send the input to.
+ */
+void end_benchmark_gesture(BenchmarkGesture *gesture, Display *display);
@@ -0,0 +1,227 @@
+/**
+ * This code is responsible for the entry point of the benchmark.
+ *
+ * The benchmark measures the window manager under a growing number of
+ * synthetic clients. For every window count, all clients repaint at a fixed
+ * rate while the top portal is dragged and resized, and the frame statistics
+ * of the window manager are reported along with the CPU time of the X server.
+ */
+
+#include "all.h"
+
+/** How long clients are left to settle after being added, in seconds. */
+#define SETTLE_DURATION 1
+
+static const unsigned int default_window_counts[] = { 1, 2, 5, 10, 20, 50, 100, 150, 200 };
+
+typedef struct {
+    const char *window_manager_path;
+    const char *log_path;
+    unsigned int repaint_rate;
+    unsigned int duration;
+    unsigned int *window_counts;
+    unsigned int step_count;
+} BenchmarkOptions;
+
+static uint64_t get_time()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ULL + (uint64_t)time.tv_nsec;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s --window-manager <path> [--repaint-rate <hz>] "
+        "[--duration <seconds>] [--log <path>] [window counts...]\n",
+        program);
+}
+
+static int parse_options(int argc, char **argv, BenchmarkOptions *out_options)
+{
+    *out_options = (BenchmarkOptions){
+        .window_manager_path = NULL,
+        .log_path = NULL,
+        .repaint_rate = 60,
+        .duration = 5,
+        .window_counts = NULL,
+        .step_count = 0
+    };
+
+    // Make room for the given window counts, or the default ones.
+    unsigned int default_count = sizeof(default_window_counts) / sizeof(default_window_counts[0]);
+    out_options->window_counts = malloc((argc + default_count) * sizeof(unsigned int));
+    if (out_options->window_counts == NULL) return -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--window-manager") == 0 && has_value)
+        {
+            out_options->window_manager_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--log") == 0 && has_value)
+        {
+            out_options->log_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--repaint-rate") == 0 && has_value)
+        {
+            out_options->repaint_rate = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && has_value)
+        {
+            out_options->duration = (unsigned int)strtoul(argv[++i], NULL, 10);
+        }
+        else if (isdigit((unsigned char)argv[i][0]))
+        {
+            out_options->window_counts[out_options->step_count] = (unsigned int)strtoul(argv[i], NULL, 10);
+            out_options->step_count++;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    // Ensure the options are usable.
+    if (out_options->window_manager_path == NULL) return -1;
+    if (out_options->repaint_rate == 0 || out_options->duration == 0) return -1;
+
+    // Sweep the default window counts, if none were given.
+    if (out_options->step_count == 0)
+    {
+        memcpy(out_options->window_counts, default_window_counts, sizeof(default_window_counts));
+        out_options->step_count = default_count;
+    }
+
+    return 0;
+}
+
+static void run_benchmark_phase(BenchmarkSession *session, BenchmarkClients *clients,
+    unsigned int repaint_rate, unsigned int duration, bool perform_gestures)
+{
+    Display *display = session->display;
+    uint64_t interval = 1000000000ULL / repaint_rate;
+    uint64_t end_time = get_time() + (uint64_t)duration * 1000000000ULL;
+
+    BenchmarkGesture gesture = { .active = false };
+    GestureKind next_gesture_kind = GESTURE_DRAG;
+
+    for (uint64_t tick_time = get_time(); tick_time < end_time; tick_time += interval)
+    {
+        repaint_benchmark_clients(clients);
+
+        // Alternate between dragging and resizing the top portal.
+        if (perform_gestures && !advance_benchmark_gesture(&gesture, display))
+        {
+            Window client_window = get_top_benchmark_client(clients);
+            if (begin_benchmark_gesture(&gesture, display, client_window, next_gesture_kind))
+            {
+                next_gesture_kind = (next_gesture_kind == GESTURE_DRAG) ? GESTURE_RESIZE : GESTURE_DRAG;
+            }
+        }
+        XFlush(display);
+
+        // Discard the events of our connection, and keep the window manager
+        // from blocking on its output.
+        while (XPending(display) > 0)
+        {
+            XEvent event;
+            XNextEvent(display, &event);
+        }
+        read_window_manager_output(session);
+
+        // Wait for the next repaint. If we fell behind, repaint right away.
+        uint64_t next_tick_time = tick_time + interval;
+        struct timespec wake_time = {
+            .tv_sec = next_tick_time / 1000000000ULL,
+            .tv_nsec = next_tick_time % 1000000000ULL
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time, NULL);
+    }
+
+    // Release the pointer, so the next phase starts without a gesture.
+    end_benchmark_gesture(&gesture, display);
+    XSync(display, False);
+}
+
+static int run_benchmark_step(BenchmarkSession *session, BenchmarkClients *clients,
+    BenchmarkOptions *options, unsigned int window_count)
+{
+    // Add the clients, and let the window manager frame them.
+    if (add_benchmark_clients(clients, window_count) != 0) return -1;
+    run_benchmark_phase(session, clients, options->repaint_rate, SETTLE_DURATION, false);
+
+    // Start measuring from scratch.
+    char marker[64];
+    snprintf(marker, sizeof(marker), "--- %u windows ---", window_count);
+    write_session_log(session, marker);
+    if (request_frame_report(session, NULL) != 0) return -1;
+    double start_cpu_time = get_server_cpu_time(session);
+
+    run_benchmark_phase(session, clients, options->repaint_rate, options->duration, true);
+
+    // Collect the measurements.
+    FrameReport report;
+    if (request_frame_report(session, &report) != 0) return -1;
+    double server_cpu_time = get_server_cpu_time(session) - start_cpu_time;
+
+    printf("%8u %8llu %12.1f %12.1f %10.1f %11.1f%%\n",
+        window_count,
+        report.frame_count,
+        report.mean_time,
+        report.worst_time,
+        report.mean_request_count,
+        server_cpu_time / options->duration * 100.0);
+    fflush(stdout);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkOptions options;
+    if (parse_options(argc, argv, &options) != 0)
+    {
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Start the server and the window manager.
+    BenchmarkSession session;
+    if (start_benchmark_session(&session, options.window_manager_path, options.log_path) != 0)
+    {
+        stop_benchmark_session(&session);
+        exit(EXIT_FAILURE);
+    }
+
+    // Ensure input can be synthesized.
+    int event_base, error_base, major_version, minor_version;
+    if (!XTestQueryExtension(session.display, &event_base, &error_base, &major_version, &minor_version))
+    {
+        LOG_ERROR("XTest extension is not available.");
+        stop_benchmark_session(&session);
+        exit(EXIT_FAILURE);
+    }
+
+    BenchmarkClients clients;
+    initialize_benchmark_clients(&clients, session.display);
+
+    // Measure every window count, with times in microseconds.
+    printf("%8s %8s %12s %12s %10s %12s\n",
+        "windows", "frames", "mean (us)", "worst (us)", "requests", "server cpu");
+    int status = EXIT_SUCCESS;
+    for (unsigned int i = 0; i < options.step_count; i++)
+    {
+        if (run_benchmark_step(&session, &clients, &options, options.window_counts[i]) != 0)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    stop_benchmark_session(&session);
+    free(options.window_counts);
+    return status;
+}
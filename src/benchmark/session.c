@@ -0,0 +1,390 @@
+/**
+ * This code is responsible for the benchmark session.
+ *
+ * A session runs an Xvfb server on a free display, along with the window
+ * manager, configured through a temporary home directory to measure its
+ * frames. The output of the window manager is read back to collect its frame
+ * statistics, which it logs whenever it receives `SIGUSR1`.
+ */
+
+#include "all.h"
+
+/** The configuration the window manager is benchmarked with. */
+#define BENCHMARK_CONFIG \
+    CFG_KEY_FRAME_STATISTICS "=1\n" \
+    CFG_KEY_HANDLER_PROFILING "=1\n"
+
+/** How long to wait for the window manager to respond, in milliseconds. */
+#define SESSION_TIMEOUT_MS 5000
+
+/** The prefix of the frame statistics logged by the window manager. */
+#define FRAME_REPORT_PREFIX "Frame statistics: "
+
+static pid_t spawn_process(const char *path, char *const arguments[], int output_fd)
+{
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    // Redirect the output of the child process, discarding it if unwanted.
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(output_fd >= 0 ? output_fd : null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+
+    execvp(path, arguments);
+    _exit(EXIT_FAILURE);
+}
+
+static int start_server(BenchmarkSession *session, char *out_display_name, size_t display_name_size)
+{
+    // Let the server choose a free display, which it reports once it accepts
+    // connections.
+    int display_pipe[2];
+    if (pipe(display_pipe) != 0)
+    {
+        LOG_ERROR("Could not start Xvfb: %s", strerror(errno));
+        return -1;
+    }
+    char display_fd[16];
+    snprintf(display_fd, sizeof(display_fd), "%d", display_pipe[1]);
+
+    char *arguments[] = {
+        "Xvfb",
+        "-displayfd", display_fd,
+        "-screen", "0", "1920x1080x24",
+        "-nolisten", "tcp",
+        "-noreset",
+        NULL
+    };
+    session->server_pid = spawn_process("Xvfb", arguments, -1);
+    close(display_pipe[1]);
+    if (session->server_pid < 0)
+    {
+        LOG_ERROR("Could not start Xvfb: %s", strerror(errno));
+        close(display_pipe[0]);
+        return -1;
+    }
+
+    // Wait for the display number.
+    char display_number[16] = {0};
+    ssize_t length = read(display_pipe[0], display_number, sizeof(display_number) - 1);
+    close(display_pipe[0]);
+    if (length <= 0)
+    {
+        LOG_ERROR("Could not start Xvfb, is it installed?");
+        return -1;
+    }
+    display_number[strcspn(display_number, "\n")] = '\0';
+
+    snprintf(out_display_name, display_name_size, ":%s", display_number);
+    return 0;
+}
+
+static int create_home_directory(BenchmarkSession *session)
+{
+    // Create a home directory of our own, so the user's configuration is
+    // neither used nor modified.
+    snprintf(session->home_path, sizeof(session->home_path), "/tmp/limeos-window-manager-benchmark-XXXXXX");
+    if (mkdtemp(session->home_path) == NULL)
+    {
+        LOG_ERROR("Could not create home directory: %s", strerror(errno));
+        session->home_path[0] = '\0';
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/.config", session->home_path);
+    if (mkdir(path, 0700) != 0)
+    {
+        LOG_ERROR("Could not create configuration directory: %s", strerror(errno));
+        return -1;
+    }
+
+    // Write the configuration of the window manager.
+    snprintf(path, sizeof(path), "%s/.config/limeos-window-manager", session->home_path);
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        LOG_ERROR("Could not write configuration file: %s", strerror(errno));
+        return -1;
+    }
+    fputs(BENCHMARK_CONFIG, file);
+    fclose(file);
+
+    return 0;
+}
+
+static void remove_home_directory(BenchmarkSession *session)
+{
+    if (session->home_path[0] == '\0') return;
+
+    // Remove what we created, leaving anything else in place.
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/.config/limeos-window-manager", session->home_path);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/.config", session->home_path);
+    rmdir(path);
+    rmdir(session->home_path);
+}
+
+static int start_window_manager(BenchmarkSession *session, const char *window_manager_path, const char *display_name)
+{
+    int output_pipe[2];
+    if (pipe(output_pipe) != 0)
+    {
+        LOG_ERROR("Could not start window manager: %s", strerror(errno));
+        return -1;
+    }
+
+    // Keep the pipe from being inherited, other than as the output.
+    fcntl(output_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(output_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    // Run the window manager on the server, with our home directory.
+    setenv("DISPLAY", display_name, 1);
+    setenv("HOME", session->home_path, 1);
+    char *arguments[] = { (char *)window_manager_path, NULL };
+    session->window_manager_pid = spawn_process(window_manager_path, arguments, output_pipe[1]);
+    close(output_pipe[1]);
+    if (session->window_manager_pid < 0)
+    {
+        LOG_ERROR("Could not start window manager: %s", strerror(errno));
+        close(output_pipe[0]);
+        return -1;
+    }
+
+    // Read the output without blocking, as it's read in between repaints.
+    session->output_fd = output_pipe[0];
+    fcntl(session->output_fd, F_SETFL, fcntl(session->output_fd, F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
+static bool is_window_manager_ready(Display *display)
+{
+    // The window manager announces itself once it's initialized.
+    Atom _NET_SUPPORTING_WM_CHECK = XInternAtom(display, "_NET_SUPPORTING_WM_CHECK", False);
+    Atom actual_type;
+    int actual_format;
+    unsigned long item_count, bytes_after;
+    unsigned char *data = NULL;
+    int status = XGetWindowProperty(
+        display,
+        DefaultRootWindow(display),
+        _NET_SUPPORTING_WM_CHECK,
+        0, 1, False,
+        XA_WINDOW,
+        &actual_type, &actual_format,
+        &item_count, &bytes_after,
+        &data
+    );
+    if (data != NULL) XFree(data);
+
+    return status == Success && item_count > 0;
+}
+
+static int wait_for_window_manager(BenchmarkSession *session)
+{
+    for (int elapsed_ms = 0; elapsed_ms < SESSION_TIMEOUT_MS; elapsed_ms += 10)
+    {
+        read_window_manager_output(session);
+        if (is_window_manager_ready(session->display)) return 0;
+
+        // Ensure the window manager is still running.
+        if (waitpid(session->window_manager_pid, NULL, WNOHANG) == session->window_manager_pid)
+        {
+            session->window_manager_pid = -1;
+            LOG_ERROR("Window manager exited before it was ready.");
+            return -1;
+        }
+
+        usleep(10000);
+    }
+
+    LOG_ERROR("Window manager didn't become ready in time.");
+    return -1;
+}
+
+int start_benchmark_session(BenchmarkSession *session, const char *window_manager_path, const char *log_path)
+{
+    *session = (BenchmarkSession){
+        .server_pid = -1,
+        .window_manager_pid = -1,
+        .display = NULL,
+        .home_path = "",
+        .output_fd = -1,
+        .log_file = NULL,
+        .output_length = 0,
+        .frame_report_received = false
+    };
+
+    // Open the log, if requested.
+    if (log_path != NULL)
+    {
+        session->log_file = fopen(log_path, "w");
+        if (session->log_file == NULL)
+        {
+            LOG_ERROR("Could not open log file (%s): %s", log_path, strerror(errno));
+            return -1;
+        }
+    }
+
+    // Start the server, and connect to it.
+    char display_name[32];
+    if (start_server(session, display_name, sizeof(display_name)) != 0) return -1;
+    session->display = XOpenDisplay(display_name);
+    if (session->display == NULL)
+    {
+        LOG_ERROR("Could not open display %s.", display_name);
+        return -1;
+    }
+
+    // Start the window manager, and wait until it manages windows.
+    if (create_home_directory(session) != 0) return -1;
+    if (start_window_manager(session, window_manager_path, display_name) != 0) return -1;
+    if (wait_for_window_manager(session) != 0) return -1;
+
+    return 0;
+}
+
+void stop_benchmark_session(BenchmarkSession *session)
+{
+    // Stop the window manager first, so it doesn't lose its server.
+    if (session->window_manager_pid > 0)
+    {
+        kill(session->window_manager_pid, SIGTERM);
+        waitpid(session->window_manager_pid, NULL, 0);
+        session->window_manager_pid = -1;
+    }
+    if (session->output_fd >= 0)
+    {
+        close(session->output_fd);
+        session->output_fd = -1;
+    }
+
+    if (session->display != NULL)
+    {
+        XCloseDisplay(session->display);
+        session->display = NULL;
+    }
+    if (session->server_pid > 0)
+    {
+        kill(session->server_pid, SIGTERM);
+        waitpid(session->server_pid, NULL, 0);
+        session->server_pid = -1;
+    }
+
+    remove_home_directory(session);
+
+    if (session->log_file != NULL)
+    {
+        fclose(session->log_file);
+        session->log_file = NULL;
+    }
+}
+
+static void parse_output_line(BenchmarkSession *session, const char *line)
+{
+    const char *report = strstr(line, FRAME_REPORT_PREFIX);
+    if (report == NULL) return;
+    report += strlen(FRAME_REPORT_PREFIX);
+
+    // Without frames, the window manager only logs their count.
+    FrameReport frame_report = {0};
+    int field_count = sscanf(
+        report,
+        "%llu frames, mean time %lf us, worst time %lf us, mean requests %lf",
+        &frame_report.frame_count,
+        &frame_report.mean_time,
+        &frame_report.worst_time,
+        &frame_report.mean_request_count
+    );
+    if (field_count < 1) return;
+
+    session->frame_report = frame_report;
+    session->frame_report_received = true;
+}
+
+void read_window_manager_output(BenchmarkSession *session)
+{
+    if (session->output_fd < 0) return;
+
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(session->output_fd, buffer, sizeof(buffer))) > 0)
+    {
+        if (session->log_file != NULL) fwrite(buffer, 1, length, session->log_file);
+
+        // Split the output into lines, truncating overly long ones.
+        for (ssize_t i = 0; i < length; i++)
+        {
+            if (buffer[i] == '\n')
+            {
+                session->output_line[session->output_length] = '\0';
+                parse_output_line(session, session->output_line);
+                session->output_length = 0;
+            }
+            else if (session->output_length < sizeof(session->output_line) - 1)
+            {
+                session->output_line[session->output_length] = buffer[i];
+                session->output_length++;
+            }
+        }
+    }
+}
+
+int request_frame_report(BenchmarkSession *session, FrameReport *out_report)
+{
+    session->frame_report_received = false;
+    kill(session->window_manager_pid, SIGUSR1);
+
+    // Wait for the window manager to log its frame statistics.
+    for (int elapsed_ms = 0; elapsed_ms < SESSION_TIMEOUT_MS; elapsed_ms += 100)
+    {
+        poll(&(struct pollfd){ .fd = session->output_fd, .events = POLLIN }, 1, 100);
+        read_window_manager_output(session);
+
+        if (session->frame_report_received)
+        {
+            if (out_report != NULL) *out_report = session->frame_report;
+            return 0;
+        }
+    }
+
+    LOG_ERROR("Window manager didn't report frame statistics in time.");
+    return -1;
+}
+
+double get_server_cpu_time(BenchmarkSession *session)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", session->server_pid);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return 0;
+
+    char stat[1024];
+    size_t length = fread(stat, 1, sizeof(stat) - 1, file);
+    fclose(file);
+    stat[length] = '\0';
+
+    // Skip past the process name, which may contain spaces, to the state.
+    char *fields = strrchr(stat, ')');
+    if (fields == NULL) return 0;
+
+    // Read the user and system time, in clock ticks.
+    unsigned long user_time, system_time;
+    if (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+        &user_time, &system_time) != 2)
+    {
+        return 0;
+    }
+
+    return (double)(user_time + system_time) / sysconf(_SC_CLK_TCK);
+}
+
+void write_session_log(BenchmarkSession *session, const char *message)
+{
+    if (session->log_file == NULL) return;
+
+    fprintf(session->log_file, "%s\n", message);
+    fflush(session->log_file);
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "all.h"
+
+/**
+ * The frame statistics logged by the window manager, covering the frames
+ * drawn since its previous log.
+ */
+typedef struct {
+    unsigned long long frame_count;
+    double mean_time;
+    double worst_time;
+    double mean_request_count;
+} FrameReport;
+
+/**
+ * A benchmark session, consisting of an Xvfb server and the window manager
+ * running on it.
+ */
+typedef struct {
+    pid_t server_pid;
+    pid_t window_manager_pid;
+    Display *display;
+    char home_path[64];
+    int output_fd;
+    FILE *log_file;
+    char output_line[1024];
+    size_t output_length;
+    FrameReport frame_report;
+    bool frame_report_received;
+} BenchmarkSession;
+
+/**
+ * Starts an Xvfb server on a free display, and the window manager on it with
+ * frame statistics and handler profiling enabled.
+ *
+ * @param session The session to start.
+ * @param window_manager_path The path of the window manager executable.
+ * @param log_path The path to write the output of the window manager to, or
+ * `NULL` to discard it.
+ *
+ * @return - `0` The session was started, and the window manager is ready.
+ * @return - `-1` The session could not be started.
+ */
+int start_benchmark_session(BenchmarkSession *session, const char *window_manager_path, const char *log_path);
+
+/**
+ * Stops the window manager and the Xvfb server of a session, and removes the
+ * files created for it.
+ *
+ * @param session The session to stop.
+ */
+void stop_benchmark_session(BenchmarkSession *session);
+
+/**
+ * Reads the available output of the window manager without blocking, taking
+ * note of the frame statistics it contains.
+ *
+ * @param session The session of the window manager.
+ *
+ * @note Must be called regularly, as the window manager blocks once its output
+ * is not read.
+ */
+void read_window_manager_output(BenchmarkSession *session);
+
+/**
+ * Requests the frame statistics of the window manager, which also resets
+ * them.
+ *
+ * @param session The session of the window manager.
+ * @param out_report The output parameter to store the frame statistics, or
+ * `NULL` to only reset them.
+ *
+ * @return - `0` The frame statistics were received.
+ * @return - `-1` The window manager didn't respond in time.
+ */
+int request_frame_report(BenchmarkSession *session, FrameReport *out_report);
+
+/**
+ * Retrieves the CPU time consumed by the Xvfb server so far.
+ *
+ * @param session The session of the server.
+ *
+ * @return The user and system CPU time in seconds, or `0` if it could not be
+ * read.
+ */
+double get_server_cpu_time(BenchmarkSession *session);
+
+/**
+ * Writes a line to the log of a session, so the output of the window manager
+ * can be told apart by benchmark step.
+ *
+ * @param session The session to write to.
+ * @param message The line to write.
+ */
+void write_session_log(BenchmarkSession *session, const char *message);
@@ -3,20 +3,130 @@
  *
  * It handles rendering borders for portals, including luminance-based
  * adaptive coloring for the client area border and title bar separator.
+ *
+ * Luminance is cached on each portal and only sampled again once its client
+ * area is damaged. Sampling downscales the client area on the server into a
+ * small pixmap, which is then fetched at once, through MIT-SHM if available.
  */
 
 #include "../all.h"
 
+/** The width and height of the downscaled client area in pixels. */
+#define BORDER_SAMPLE_SIZE 8
+
+static bool damage_available = false;
+
+static Pixmap sample_pixmap = None;
+static cairo_surface_t *sample_surface = NULL;
+static cairo_t *sample_cr = NULL;
+
+static bool shm_enabled = false;
+static XShmSegmentInfo shm_segment = { 0 };
+static XImage *shm_image = NULL;
+
+static void destroy_shm_image(Display *display)
+{
+    // Detach the shared memory from the server and this process.
+    if (shm_enabled) XShmDetach(display, &shm_segment);
+    shmdt(shm_segment.shmaddr);
+
+    // Destroy the image, which doesn't free the shared memory it points to.
+    shm_image->data = NULL;
+    XDestroyImage(shm_image);
+    shm_image = NULL;
+    shm_enabled = false;
+}
+
+static bool create_sample_surface(Display *display)
+{
+    Window root_window = DefaultRootWindow(display);
+    int screen = DefaultScreen(display);
+    Visual *visual = DefaultVisual(display, screen);
+    int depth = DefaultDepth(display, screen);
+
+    // Create the pixmap the client area is downscaled into.
+    sample_pixmap = XCreatePixmap(display, root_window,
+        BORDER_SAMPLE_SIZE, BORDER_SAMPLE_SIZE, depth);
+    sample_surface = cairo_xlib_surface_create(display, sample_pixmap,
+        visual, BORDER_SAMPLE_SIZE, BORDER_SAMPLE_SIZE);
+    if (cairo_surface_status(sample_surface) != CAIRO_STATUS_SUCCESS)
+    {
+        LOG_WARNING("Could not create luminance sample surface.");
+        cairo_surface_destroy(sample_surface);
+        XFreePixmap(display, sample_pixmap);
+        sample_surface = NULL;
+        sample_pixmap = None;
+        return false;
+    }
+    sample_cr = cairo_create(sample_surface);
+
+    // Check if MIT-SHM extension is available, otherwise fall back to
+    // fetching the downscaled pixels through the connection.
+    if (!XShmQueryExtension(display)) return true;
+
+    // Create an image backed by shared memory.
+    shm_image = XShmCreateImage(display, visual, depth, ZPixmap, NULL,
+        &shm_segment, BORDER_SAMPLE_SIZE, BORDER_SAMPLE_SIZE);
+    if (shm_image == NULL) return true;
+    shm_segment.shmid = shmget(IPC_PRIVATE,
+        shm_image->bytes_per_line * shm_image->height, IPC_CREAT | 0600);
+    if (shm_segment.shmid < 0)
+    {
+        XDestroyImage(shm_image);
+        shm_image = NULL;
+        return true;
+    }
+    shm_segment.shmaddr = shmat(shm_segment.shmid, NULL, 0);
+    if (shm_segment.shmaddr == (void *)-1)
+    {
+        shmctl(shm_segment.shmid, IPC_RMID, NULL);
+        XDestroyImage(shm_image);
+        shm_image = NULL;
+        return true;
+    }
+    shm_image->data = shm_segment.shmaddr;
+    shm_segment.readOnly = False;
+
+    // Share the memory with the server. The segment is marked for removal
+    // right away, so it's freed once both sides detach from it. Servers on
+    // other machines fail to attach, which is detected on the first fetch.
+    XShmAttach(display, &shm_segment);
+    XSync(display, False);
+    shmctl(shm_segment.shmid, IPC_RMID, NULL);
+    shm_enabled = true;
+
+    return true;
+}
+
+static XImage *fetch_sample_image(Display *display)
+{
+    // Fetch the downscaled pixels through shared memory.
+    if (shm_enabled)
+    {
+        if (XShmGetImage(display, sample_pixmap, shm_image, 0, 0, AllPlanes))
+        {
+            return shm_image;
+        }
+
+        // The server can't access the shared memory, so stop trying.
+        LOG_WARNING("MIT-SHM not usable, fetching luminance samples directly.");
+        destroy_shm_image(display);
+    }
+
+    // Fetch the downscaled pixels in a single request.
+    return XGetImage(display, sample_pixmap, 0, 0,
+        BORDER_SAMPLE_SIZE, BORDER_SAMPLE_SIZE, AllPlanes, ZPixmap);
+}
+
 /**
  * Samples the client area of a portal to determine content luminance.
  *
  * @param display The X display connection.
- * @param pixmap The window pixmap to sample from.
- * @param portal The portal containing geometry information.
+ * @param portal The portal to sample, with its window surface acquired.
  *
  * @return Luminance value from 0.0 (dark) to 1.0 (light).
  */
-static float sample_client_luminance(Display *display, Pixmap pixmap, Portal *portal)
+static float sample_client_luminance(Display *display, Portal *portal)
 {
     // Calculate client area bounds within the frame.
     int client_x = PORTAL_BORDER_WIDTH;
@@ -30,62 +140,57 @@ static float sample_client_luminance(Display *display, Pixmap pixmap, Portal *po
         return 0.0f;
     }
 
-    // Define sample points within the client area.
-    int margin = 10;
-    int sample_points[][2] = {
-        { client_x + client_width / 2, client_y + client_height / 2 },           // Center
-        { client_x + margin, client_y + margin },                                // Top-left
-        { client_x + client_width - margin, client_y + margin },                 // Top-right
-        { client_x + margin, client_y + client_height - margin },                // Bottom-left
-        { client_x + client_width - margin, client_y + client_height - margin }, // Bottom-right
-    };
-    int num_samples = sizeof(sample_points) / sizeof(sample_points[0]);
-
-    // Sample pixels and calculate average luminance.
-    double total_luminance = 0.0;
-    int valid_samples = 0;
-    for (int i = 0; i < num_samples; i++)
+    // Ensure the sample surface exists.
+    if (sample_cr == NULL && !create_sample_surface(display))
     {
-        int x = sample_points[i][0];
-        int y = sample_points[i][1];
-
-        // Clamp to valid coordinates.
-        if (x < client_x) x = client_x;
-        if (x >= client_x + client_width) x = client_x + client_width - 1;
-        if (y < client_y) y = client_y;
-        if (y >= client_y + client_height) y = client_y + client_height - 1;
-
-        // Get single pixel.
-        XImage *img = XGetImage(display, pixmap, x, y, 1, 1, AllPlanes, ZPixmap);
-        if (img == NULL)
-        {
-            continue;
-        }
-
-        // Retrieve pixel value.
-        unsigned long pixel = XGetPixel(img, 0, 0);
-        XDestroyImage(img);
+        return 0.0f;
+    }
 
-        // Extract RGB components.
-        unsigned char r = (pixel >> 16) & 0xFF;
-        unsigned char g = (pixel >> 8) & 0xFF;
-        unsigned char b = pixel & 0xFF;
+    // Downscale the client area into the sample surface on the server.
+    cairo_save(sample_cr);
+    cairo_scale(sample_cr,
+        (double)BORDER_SAMPLE_SIZE / client_width,
+        (double)BORDER_SAMPLE_SIZE / client_height);
+    cairo_set_source_surface(sample_cr, portal->window_surface, -client_x, -client_y);
+    cairo_pattern_set_filter(cairo_get_source(sample_cr), CAIRO_FILTER_BILINEAR);
+    cairo_set_operator(sample_cr, CAIRO_OPERATOR_SOURCE);
+    cairo_paint(sample_cr);
+    cairo_restore(sample_cr);
+    cairo_surface_flush(sample_surface);
 
-        // Calculate relative luminance using standard coefficients.
-        double luminance = (0.299 * r + 0.587 * g + 0.114 * b) / 255.0;
-        total_luminance += luminance;
-        valid_samples++;
+    // Fetch the downscaled pixels.
+    XImage *image = fetch_sample_image(display);
+    if (image == NULL)
+    {
+        return 0.0f;
     }
 
-    if (valid_samples == 0)
+    // Calculate the average luminance of the downscaled pixels.
+    double total_luminance = 0.0;
+    for (int y = 0; y < BORDER_SAMPLE_SIZE; y++)
     {
-        return 0.0f;
+        for (int x = 0; x < BORDER_SAMPLE_SIZE; x++)
+        {
+            // Retrieve pixel value.
+            unsigned long pixel = XGetPixel(image, x, y);
+
+            // Extract RGB components.
+            unsigned char r = (pixel >> 16) & 0xFF;
+            unsigned char g = (pixel >> 8) & 0xFF;
+            unsigned char b = pixel & 0xFF;
+
+            // Calculate relative luminance using standard coefficients.
+            total_luminance += (0.299 * r + 0.587 * g + 0.114 * b) / 255.0;
+        }
     }
 
-    return (float)(total_luminance / valid_samples);
+    // Free the image, unless it's the reused shared memory image.
+    if (image != shm_image) XDestroyImage(image);
+
+    return (float)(total_luminance / (BORDER_SAMPLE_SIZE * BORDER_SAMPLE_SIZE));
 }
 
-void draw_portal_border(cairo_t *cr, Portal *portal, Pixmap pixmap)
+void draw_portal_border(cairo_t *cr, Portal *portal)
 {
     Display *display = DefaultDisplay;
     const Theme *theme = get_current_theme();
@@ -97,8 +202,14 @@ void draw_portal_border(cairo_t *cr, Portal *portal, Pixmap pixmap)
     double radius = PORTAL_CORNER_RADIUS;
     double title_height = PORTAL_TITLE_BAR_HEIGHT;
 
-    // Sample luminance to determine border colors.
-    float luminance = sample_client_luminance(display, pixmap, portal);
+    // Sample luminance to determine border colors, if the client area has
+    // changed since it was last sampled.
+    if (portal->luminance_outdated || !damage_available)
+    {
+        portal->luminance = sample_client_luminance(display, portal);
+        portal->luminance_outdated = false;
+    }
+    float luminance = portal->luminance;
 
     // Draw inner border around title bar.
     cairo_set_source_rgba(cr,
@@ -154,3 +265,53 @@ void draw_portal_border(cairo_t *cr, Portal *portal, Pixmap pixmap)
     cairo_line_to(cr, x + width, y + title_height - 0.5);
     cairo_stroke(cr);
 }
+
+HANDLE(Initialize)
+{
+    // Without damage reporting, changes to the client area go unnoticed, so
+    // luminance has to be sampled every time.
+    damage_available = XDamageQueryExtension(DefaultDisplay, &(int){0}, &(int){0});
+}
+
+HANDLE(PortalDamaged)
+{
+    PortalDamagedEvent *_event = &event->portal_damaged;
+    Portal *portal = _event->portal;
+    if (portal == NULL) return;
+
+    // Ensure the damaged area overlaps the client area.
+    int client_x = PORTAL_BORDER_WIDTH;
+    int client_y = PORTAL_TITLE_BAR_HEIGHT;
+    int client_right = (int)portal->width - PORTAL_BORDER_WIDTH;
+    int client_bottom = (int)portal->height - PORTAL_BORDER_WIDTH;
+    if (_event->x_portal + (int)_event->width <= client_x) return;
+    if (_event->y_portal + (int)_event->height <= client_y) return;
+    if (_event->x_portal >= client_right) return;
+    if (_event->y_portal >= client_bottom) return;
+
+    portal->luminance_outdated = true;
+
+    // Damage the client area border and title bar separator, as their colors
+    // may change with the luminance.
+    int x = portal->x_root;
+    int y = portal->y_root;
+    int width = portal->width;
+    int height = portal->height;
+    int radius = PORTAL_CORNER_RADIUS;
+    add_damage(x, y + client_y - 1, width, 2);
+    add_damage(x, y + client_y, radius, height - client_y);
+    add_damage(x + width - radius, y + client_y, radius, height - client_y);
+    add_damage(x, y + height - radius, width, radius);
+}
+
+HANDLE(PortalMapped)
+{
+    // The content may have changed entirely while unmapped.
+    event->portal_mapped.portal->luminance_outdated = true;
+}
+
+HANDLE(PortalTransformed)
+{
+    // Resizing changes which content the client area shows.
+    event->portal_transformed.portal->luminance_outdated = true;
+}
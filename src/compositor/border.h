@@ -5,7 +5,10 @@
  * Draws borders for a portal.
  *
  * @param cr The Cairo context to draw on.
- * @param portal The portal to draw borders for.
- * @param pixmap The window pixmap to sample luminance from.
+ * @param portal The portal to draw borders for, with its window surface
+ * acquired.
+ *
+ * @note The luminance of the client area, which the border colors adapt to,
+ * is only sampled again once the client area has been damaged.
  */
-void draw_portal_border(cairo_t *cr, Portal *portal, Pixmap pixmap);
+void draw_portal_border(cairo_t *cr, Portal *portal);
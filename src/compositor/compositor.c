@@ -5,21 +5,59 @@
  * It redirects all window rendering off-screen and then composites them back
  * to the root window. Double-buffering is used to prevent flicker: all drawing
  * is done to an off-screen X11 pixmap first, then copied to the root window in
- * one operation.
+ * one operation, clipped to the damaged areas.
+ *
+ * Only areas of the screen reported as damaged are repainted and copied to the
+ * root window. When the XDamage extension is unavailable, the entire screen
+ * is treated as damaged on every redraw.
+ *
+ * Window pixmaps and their Cairo surfaces are cached on each portal, and only
+ * named again once the window is mapped again or resized, as both allocate a
+ * new pixmap on the server.
+ *
+ * Before painting, a front-to-back visibility pass builds a region of opaque
+ * coverage from framed portals and from the _NET_WM_OPAQUE_REGION of clients
+ * that set it. Portals and background areas fully hidden behind that coverage
+ * are skipped, and the rest are only painted where they are visible.
+ *
+ * When the Present extension is available, the buffer is presented to the
+ * root window on vertical blank boundaries, and the next redraw waits until
+ * the previous frame has been displayed. Redraws are then paced by the real
+ * refresh rate instead of the configured framerate, which remains in use as
+ * a fallback timer. A presentation which fails, or doesn't complete within two
+ * frame intervals, is no longer waited for, so redraws can't stall for good.
+ *
+ * Whenever the top portal covers the entire screen and is opaque, or its
+ * client asks for it through _NET_WM_BYPASS_COMPOSITOR, the compositor is
+ * bypassed: windows are unredirected to draw to the screen directly, and
+ * redraws are suspended until the portal stops covering the screen.
  */
 
 #include "../all.h"
 
-static cairo_t *root_cr = NULL;
-static cairo_surface_t *root_surface = NULL;
+/** How many frame intervals to wait for a presentation to complete. */
+#define PRESENTATION_TIMEOUT_FRAMES 2
+
+static GC root_gc = NULL;
 static cairo_t *buffer_cr = NULL;
 static cairo_surface_t *buffer_surface = NULL;
 static Pixmap buffer_pixmap = None;
 static bool compositor_enabled = false;
+static bool damage_enabled = false;
+static bool present_enabled = false;
+static bool presentation_pending = false;
+static bool compositor_bypassed = false;
+static uint32_t presentation_serial = 0;
+static unsigned long presentation_request = 0;
+static uint64_t presentation_time = 0;
 
 static int screen_width = 0;
 static int screen_height = 0;
 
+// Per-frame visible regions of the sorted portals, reused between redraws.
+static cairo_region_t **visible_regions = NULL;
+static unsigned int visible_region_capacity = 0;
+
 static void compositor_init()
 {
     Display *display = DefaultDisplay;
@@ -43,6 +81,17 @@ static void compositor_init()
         return;
     }
 
+    // Check if XDamage extension is available, otherwise fall back to
+    // repainting the entire screen on every redraw.
+    if (XDamageQueryExtension(display, &event_base, &error_base))
+    {
+        damage_enabled = true;
+    }
+    else
+    {
+        LOG_WARNING("XDamage extension not available, repainting full screen.");
+    }
+
     // Get screen dimensions.
     screen_width = DisplayWidth(display, screen);
     screen_height = DisplayHeight(display, screen);
@@ -50,17 +99,13 @@ static void compositor_init()
     // Redirect all subwindows of the root window for manual compositing.
     XCompositeRedirectSubwindows(display, root_window, CompositeRedirectManual);
 
-    // Create a Cairo surface for drawing to the root window.
+    // Create a graphics context for copying to the root window. Redirected
+    // subwindows must not clip the copy.
     Visual *visual = DefaultVisual(display, screen);
     int depth = DefaultDepth(display, screen);
-    root_surface = cairo_xlib_surface_create(
-        display,
-        root_window,
-        visual,
-        screen_width,
-        screen_height
-    );
-    root_cr = cairo_create(root_surface);
+    root_gc = XCreateGC(display, root_window, GCSubwindowMode, &(XGCValues){
+        .subwindow_mode = IncludeInferiors
+    });
 
     // Create an off-screen X11 pixmap for double-buffering.
     buffer_pixmap = XCreatePixmap(display, root_window, screen_width, screen_height, depth);
@@ -73,57 +118,178 @@ static void compositor_init()
     );
     buffer_cr = cairo_create(buffer_surface);
 
+    // Check if Present extension is available, and if so, pace redraws by
+    // the completion of presented frames instead of the framerate.
+    if (XPresentQueryExtension(display, &(int){0}, &event_base, &error_base))
+    {
+        XPresentSelectInput(display, root_window, PresentCompleteNotifyMask);
+        disable_update_throttle();
+        present_enabled = true;
+    }
+    else
+    {
+        LOG_WARNING("Present extension not available, using framerate timer.");
+    }
+
     compositor_enabled = true;
 }
 
-static void draw_portal(Portal *portal)
+static void clip_to_region(cairo_t *cr, cairo_region_t *region)
 {
-    if (!compositor_enabled) return;
-    if (portal == NULL) return;
-    if (portal->mapped == false) return;
-    if (portal->initialized == false) return;
+    // Add every rectangle of the region to the path, then clip to it.
+    int rectangle_count = cairo_region_num_rectangles(region);
+    for (int i = 0; i < rectangle_count; i++)
+    {
+        cairo_rectangle_int_t rectangle;
+        cairo_region_get_rectangle(region, i, &rectangle);
+        cairo_rectangle(cr, rectangle.x, rectangle.y, rectangle.width, rectangle.height);
+    }
+    cairo_clip(cr);
+}
+
+static XRectangle *get_region_rectangles(cairo_region_t *region, int *out_count)
+{
+    // Allocate memory for the rectangles.
+    int rectangle_count = cairo_region_num_rectangles(region);
+    XRectangle *rectangles = malloc(rectangle_count * sizeof(XRectangle));
+    if (rectangles == NULL) return NULL;
 
+    // Convert every rectangle of the region.
+    for (int i = 0; i < rectangle_count; i++)
+    {
+        cairo_rectangle_int_t rectangle;
+        cairo_region_get_rectangle(region, i, &rectangle);
+        rectangles[i] = (XRectangle){
+            .x = rectangle.x,
+            .y = rectangle.y,
+            .width = rectangle.width,
+            .height = rectangle.height
+        };
+    }
+
+    *out_count = rectangle_count;
+    return rectangles;
+}
+
+static void copy_buffer_to_root(cairo_region_t *region)
+{
     Display *display = DefaultDisplay;
-    bool has_frame = is_portal_frame_valid(portal);
-    Visual *visual = portal->visual;
+    Window root_window = DefaultRootWindow(display);
 
-    // Get the window to composite (frame if it exists, otherwise client).
-    Window target_window = has_frame ?
-        portal->frame_window : portal->client_window;
+    // Ensure all drawing has been sent to the buffer pixmap.
+    cairo_surface_flush(buffer_surface);
+
+    // Clip the copy to the given region, or copy the entire buffer if the
+    // region can't be converted. Cairo regions are always banded.
+    int rectangle_count = 0;
+    XRectangle *rectangles = get_region_rectangles(region, &rectangle_count);
+    if (rectangles != NULL)
+    {
+        XSetClipRectangles(display, root_gc, 0, 0, rectangles, rectangle_count, YXBanded);
+        free(rectangles);
+    }
+    else
+    {
+        XSetClipMask(display, root_gc, None);
+    }
 
-    // Grab the server to prevent window destruction during pixmap operations.
-    XGrabServer(display);
+    // Copy the extents of the region, leaving the rest to the clip.
+    cairo_rectangle_int_t extents;
+    cairo_region_get_extents(region, &extents);
+    XCopyArea(display, buffer_pixmap, root_window, root_gc,
+        extents.x, extents.y, extents.width, extents.height,
+        extents.x, extents.y);
+}
 
-    // Verify override-redirect windows are viewable before getting their pixmap.
-    // These windows are controlled by clients and can change state rapidly.
-    // Framed portals are controlled by us, so we trust portal->mapped.
-    if (portal->override_redirect)
+static void present_buffer(cairo_region_t *region)
+{
+    Display *display = DefaultDisplay;
+    Window root_window = DefaultRootWindow(display);
+
+    // Ensure all drawing has been sent to the buffer pixmap.
+    cairo_surface_flush(buffer_surface);
+
+    // Limit the presentation to the given region, or present the entire
+    // buffer if the region can't be converted.
+    XserverRegion update_region = None;
+    int rectangle_count = 0;
+    XRectangle *rectangles = get_region_rectangles(region, &rectangle_count);
+    if (rectangles != NULL)
     {
-        XWindowAttributes attrs;
-        if (!XGetWindowAttributes(display, target_window, &attrs) ||
-            attrs.map_state != IsViewable)
-        {
-            XUngrabServer(display);
-            return;
-        }
+        update_region = XFixesCreateRegion(display, rectangles, rectangle_count);
+        free(rectangles);
     }
 
-    // Get the window pixmap.
-    Pixmap pixmap = XCompositeNameWindowPixmap(display, target_window);
-    if (pixmap == None)
+    // Copy the buffer to the root window on the next vertical blank. Copying
+    // (rather than flipping) guarantees the buffer can be drawn to again
+    // once the presentation completes.
+    presentation_serial++;
+    presentation_request = NextRequest(display);
+    XPresentPixmap(
+        display,                // Display
+        root_window,            // Window
+        buffer_pixmap,          // Pixmap
+        presentation_serial,    // Serial
+        None,                   // Valid region
+        update_region,          // Update region
+        0, 0,                   // X, Y offset
+        None,                   // Target CRTC
+        None,                   // Wait fence
+        None,                   // Idle fence
+        PresentOptionCopy,      // Options
+        0, 0, 0,                // Target MSC, divisor, remainder
+        NULL, 0                 // Notifies
+    );
+    presentation_pending = true;
+    presentation_time = get_monotonic_time();
+
+    // The server keeps its own copy of the update region.
+    if (update_region != None) XFixesDestroyRegion(display, update_region);
+}
+
+static void release_portal_pixmap(Portal *portal)
+{
+    Display *display = DefaultDisplay;
+
+    // Ignore errors of pixmaps that failed to be named.
+    x_begin_ignoring_errors(display);
+
+    // Destroy the cached Cairo surface.
+    if (portal->window_surface != NULL)
     {
-        XUngrabServer(display);
-        return;
+        cairo_surface_destroy(portal->window_surface);
+        portal->window_surface = NULL;
     }
 
-    // Release the server grab now that we have the pixmap.
-    XUngrabServer(display);
+    // Free the cached window pixmap.
+    if (portal->window_pixmap != None)
+    {
+        XFreePixmap(display, portal->window_pixmap);
+        portal->window_pixmap = None;
+    }
+
+    x_end_ignoring_errors(display);
+}
+
+static bool acquire_portal_pixmap(Portal *portal, Window target_window)
+{
+    Display *display = DefaultDisplay;
+
+    // Reuse the cached pixmap, it stays valid until the window is unmapped
+    // or resized.
+    if (portal->window_surface != NULL) return true;
+
+    // Get the window pixmap. Viewability is tracked through map and unmap
+    // events instead of querying the server, so naming may still race against
+    // the client, in which case the resulting errors are ignored.
+    Pixmap pixmap = XCompositeNameWindowPixmap(display, target_window);
+    if (pixmap == None) return false;
 
     // Create a Cairo surface from the pixmap using cached dimensions.
     cairo_surface_t *window_surface = cairo_xlib_surface_create(
         display,
         pixmap,
-        visual,
+        portal->visual,
         portal->width,
         portal->height
     );
@@ -133,8 +299,45 @@ static void draw_portal(Portal *portal)
     {
         cairo_surface_destroy(window_surface);
         XFreePixmap(display, pixmap);
+        return false;
+    }
+
+    // Cache the pixmap and surface on the portal.
+    portal->window_pixmap = pixmap;
+    portal->window_surface = window_surface;
+
+    return true;
+}
+
+static void draw_portal(Portal *portal)
+{
+    if (!compositor_enabled) return;
+    if (portal == NULL) return;
+    if (portal->mapped == false) return;
+    if (portal->initialized == false) return;
+
+    Display *display = DefaultDisplay;
+
+    // Frame windows are only ever destroyed by us, so a set frame window is
+    // known to be valid without asking the server.
+    bool has_frame = (portal->frame_window != None);
+
+    // Get the window to composite (frame if it exists, otherwise client).
+    Window target_window = has_frame ?
+        portal->frame_window : portal->client_window;
+
+    // Ignore errors caused by the client unmapping or destroying its window
+    // mid-frame. The resulting UnmapNotify or DestroyNotify event releases the
+    // portal's pixmap shortly after.
+    x_begin_ignoring_errors(display);
+
+    // Get the window pixmap and its Cairo surface.
+    if (!acquire_portal_pixmap(portal, target_window))
+    {
+        x_end_ignoring_errors(display);
         return;
     }
+    cairo_surface_t *window_surface = portal->window_surface;
 
     // Draw the window surface to the off-screen buffer.
     if (has_frame)
@@ -152,7 +355,7 @@ static void draw_portal(Portal *portal)
         cairo_restore(buffer_cr);
 
         // Draw borders (includes luminance sampling).
-        draw_portal_border(buffer_cr, portal, pixmap);
+        draw_portal_border(buffer_cr, portal);
     }
     else
     {
@@ -161,12 +364,195 @@ static void draw_portal(Portal *portal)
         cairo_paint(buffer_cr);
     }
 
+    // Remember where the portal was composited to, so the area can be
+    // damaged once the portal moves away or disappears.
+    portal->composited_bounds = get_portal_composited_bounds(portal);
+
     // Clear the source to release Cairo's reference to window_surface.
     cairo_set_source_rgb(buffer_cr, 0, 0, 0);
 
-    // Cleanup.
-    cairo_surface_destroy(window_surface);
-    XFreePixmap(display, pixmap);
+    x_end_ignoring_errors(display);
+}
+
+static void update_portal_opaque_region(Portal *portal)
+{
+    Display *display = DefaultDisplay;
+
+    // Forget about the previous opaque region.
+    if (portal->opaque_region != NULL)
+    {
+        cairo_region_destroy(portal->opaque_region);
+        portal->opaque_region = NULL;
+    }
+
+    // Retrieve the opaque region the client has set, if any.
+    XRectangle *rectangles = NULL;
+    int rectangle_count = 0;
+    if (x_get_window_opaque_region(display, portal->client_window, &rectangles, &rectangle_count) != 0)
+    {
+        return;
+    }
+
+    // Store the opaque region relative to the client window.
+    cairo_region_t *opaque_region = cairo_region_create();
+    for (int i = 0; i < rectangle_count; i++)
+    {
+        cairo_rectangle_int_t rectangle = {
+            rectangles[i].x,
+            rectangles[i].y,
+            rectangles[i].width,
+            rectangles[i].height
+        };
+        cairo_region_union_rectangle(opaque_region, &rectangle);
+    }
+    portal->opaque_region = opaque_region;
+    free(rectangles);
+}
+
+static cairo_region_t *get_portal_opaque_coverage(Portal *portal)
+{
+    // Frame windows are opaque, except for their rounded corners.
+    if (portal->frame_window != None)
+    {
+        cairo_region_t *coverage = cairo_region_create();
+        int radius = PORTAL_CORNER_RADIUS;
+        cairo_rectangle_int_t horizontal = {
+            portal->x_root, portal->y_root + radius,
+            portal->width, (int)portal->height - 2 * radius
+        };
+        cairo_rectangle_int_t vertical = {
+            portal->x_root + radius, portal->y_root,
+            (int)portal->width - 2 * radius, portal->height
+        };
+        if (horizontal.height > 0) cairo_region_union_rectangle(coverage, &horizontal);
+        if (vertical.width > 0) cairo_region_union_rectangle(coverage, &vertical);
+        return coverage;
+    }
+
+    // Frameless clients without an alpha channel are entirely opaque.
+    if (portal->depth != 32)
+    {
+        cairo_region_t *coverage = cairo_region_create();
+        cairo_rectangle_int_t bounds = {
+            portal->x_root, portal->y_root,
+            portal->width, portal->height
+        };
+        cairo_region_union_rectangle(coverage, &bounds);
+        return coverage;
+    }
+
+    // Frameless clients with an alpha channel are only opaque where they
+    // say they are.
+    if (portal->opaque_region != NULL)
+    {
+        cairo_region_t *coverage = cairo_region_copy(portal->opaque_region);
+        cairo_region_translate(coverage, portal->x_root, portal->y_root);
+        cairo_rectangle_int_t bounds = {
+            portal->x_root, portal->y_root,
+            portal->width, portal->height
+        };
+        cairo_region_intersect_rectangle(coverage, &bounds);
+        return coverage;
+    }
+
+    return NULL;
+}
+
+static bool ensure_visible_region_capacity(unsigned int portal_count)
+{
+    if (portal_count <= visible_region_capacity) return true;
+
+    // Grow the array of visible regions to fit every portal.
+    cairo_region_t **new_visible_regions = realloc(visible_regions, portal_count * sizeof(cairo_region_t *));
+    if (new_visible_regions == NULL)
+    {
+        LOG_ERROR("Could not determine portal visibility, memory allocation failed.");
+        return false;
+    }
+    visible_regions = new_visible_regions;
+    visible_region_capacity = portal_count;
+
+    return true;
+}
+
+static Portal *find_bypass_portal()
+{
+    // Find the top portal which is visible.
+    unsigned int portal_count = 0;
+    Portal **portals = get_sorted_portals(&portal_count);
+    Portal *portal = NULL;
+    for (int i = (int)portal_count - 1; i >= 0; i--)
+    {
+        if (portals[i] == NULL) continue;
+        if (portals[i]->mapped == false) continue;
+        if (portals[i]->initialized == false) continue;
+        portal = portals[i];
+        break;
+    }
+    if (portal == NULL) return NULL;
+
+    // Respect clients which ask not to be bypassed.
+    if (portal->bypass_compositor == 2) return NULL;
+
+    // Ensure the portal covers the entire screen.
+    cairo_rectangle_int_t screen = { 0, 0, screen_width, screen_height };
+    if (portal->x_root > 0 || portal->y_root > 0 ||
+        portal->x_root + (int)portal->width < screen_width ||
+        portal->y_root + (int)portal->height < screen_height)
+    {
+        return NULL;
+    }
+
+    // Bypass for clients which ask for it, regardless of their opacity.
+    if (portal->bypass_compositor == 1) return portal;
+
+    // Ensure nothing below the portal could show through it.
+    cairo_region_t *coverage = get_portal_opaque_coverage(portal);
+    if (coverage == NULL) return NULL;
+    bool covered = cairo_region_contains_rectangle(coverage, &screen) == CAIRO_REGION_OVERLAP_IN;
+    cairo_region_destroy(coverage);
+
+    return covered ? portal : NULL;
+}
+
+static void release_all_portal_pixmaps()
+{
+    unsigned int portal_count = 0;
+    Portal **portals = get_sorted_portals(&portal_count);
+    for (unsigned int i = 0; i < portal_count; i++)
+    {
+        if (portals[i] != NULL) release_portal_pixmap(portals[i]);
+    }
+}
+
+static void update_compositor_bypass()
+{
+    Display *display = DefaultDisplay;
+    Window root_window = DefaultRootWindow(display);
+
+    bool should_bypass = (find_bypass_portal() != NULL);
+    if (should_bypass == compositor_bypassed) return;
+
+    if (should_bypass)
+    {
+        // Let windows draw to the screen directly. Windows redirected through
+        // their parent can't be unredirected individually, so unredirect all
+        // subwindows of the root window.
+        XCompositeUnredirectSubwindows(display, root_window, CompositeRedirectManual);
+        release_all_portal_pixmaps();
+        LOG_INFO("Compositor bypassed for full-screen portal.");
+    }
+    else
+    {
+        // Redirect windows again, and repaint everything with the new window
+        // pixmaps.
+        XCompositeRedirectSubwindows(display, root_window, CompositeRedirectManual);
+        release_all_portal_pixmaps();
+        add_screen_damage();
+        LOG_INFO("Compositor resumed.");
+    }
+
+    compositor_bypassed = should_bypass;
 }
 
 static void compositor_redraw()
@@ -175,26 +561,109 @@ static void compositor_redraw()
 
     Display *display = DefaultDisplay;
 
-    // Draw the background to the off-screen buffer.
-    draw_background(buffer_cr);
+    // Suspend redraws while a full-screen portal bypasses the compositor.
+    update_compositor_bypass();
+    if (compositor_bypassed)
+    {
+        clear_damage();
+        discard_frame_latency();
+        return;
+    }
+
+    // Without damage reporting, every redraw has to repaint the full screen,
+    // which also keeps redraws coming at the configured framerate.
+    if (!damage_enabled) add_screen_damage();
 
-    // Get sorted portals and draw them to the buffer (back to front).
+    // Skip the redraw entirely if nothing has changed since the last one.
+    cairo_region_t *damage_region = get_damage_region();
+    if (cairo_region_is_empty(damage_region))
+    {
+        discard_frame_latency();
+        return;
+    }
+
+    // Get sorted portals, and make room for their visible regions.
     unsigned int portal_count = 0;
     Portal **portals = get_sorted_portals(&portal_count);
-    for (unsigned int i = 0; i < portal_count; i++)
+    if (!ensure_visible_region_capacity(portal_count)) return;
+
+    // Determine the visible part of each portal (front to back), by removing
+    // the opaque coverage of the portals above it from the damaged areas.
+    cairo_region_t *uncovered_region = cairo_region_copy(damage_region);
+    for (int i = (int)portal_count - 1; i >= 0; i--)
     {
-        if (portals[i] != NULL)
+        visible_regions[i] = NULL;
+
+        Portal *portal = portals[i];
+        if (portal == NULL) continue;
+        if (portal->mapped == false) continue;
+        if (portal->initialized == false) continue;
+
+        // Skip portals which are fully hidden or not damaged.
+        cairo_rectangle_int_t bounds = get_portal_composited_bounds(portal);
+        cairo_region_t *visible_region = cairo_region_copy(uncovered_region);
+        cairo_region_intersect_rectangle(visible_region, &bounds);
+        if (cairo_region_is_empty(visible_region))
         {
-            draw_portal(portals[i]);
+            cairo_region_destroy(visible_region);
+            continue;
+        }
+        visible_regions[i] = visible_region;
+
+        // Hide everything below the opaque parts of the portal.
+        cairo_region_t *coverage = get_portal_opaque_coverage(portal);
+        if (coverage != NULL)
+        {
+            cairo_region_subtract(uncovered_region, coverage);
+            cairo_region_destroy(coverage);
         }
     }
 
-    // Copy the completed buffer to the root window in one operation.
-    cairo_set_source_surface(root_cr, buffer_surface, 0, 0);
-    cairo_paint(root_cr);
+    // Draw the background to the off-screen buffer, where it isn't covered.
+    if (!cairo_region_is_empty(uncovered_region))
+    {
+        cairo_save(buffer_cr);
+        clip_to_region(buffer_cr, uncovered_region);
+        draw_background(buffer_cr);
+        cairo_restore(buffer_cr);
+    }
+    cairo_region_destroy(uncovered_region);
+
+    // Draw the visible portals to the buffer (back to front), each restricted
+    // to its visible region.
+    for (unsigned int i = 0; i < portal_count; i++)
+    {
+        if (visible_regions[i] == NULL) continue;
+
+        cairo_save(buffer_cr);
+        clip_to_region(buffer_cr, visible_regions[i]);
+        draw_portal(portals[i]);
+        cairo_restore(buffer_cr);
+
+        cairo_region_destroy(visible_regions[i]);
+        visible_regions[i] = NULL;
+    }
+
+    // Copy the damaged areas of the buffer to the root window.
+    if (present_enabled)
+    {
+        present_buffer(damage_region);
+    }
+    else
+    {
+        copy_buffer_to_root(damage_region);
+    }
 
     // Flush to ensure drawing is displayed.
     XFlush(display);
+
+    // Record the latency of the input which caused the frame, and what the
+    // frame cost.
+    record_frame_latency();
+    record_frame_measurement();
+
+    // Clear the damage, as it has now been repaired.
+    clear_damage();
 }
 
 HANDLE(Initialize)
@@ -202,7 +671,162 @@ HANDLE(Initialize)
     compositor_init();
 }
 
+static bool is_presentation_pending()
+{
+    if (!presentation_pending) return false;
+
+    // Stop waiting once the presentation timed out, as its completion may
+    // never arrive, such as when the root window was resized meanwhile.
+    uint64_t timeout = get_frame_interval() * PRESENTATION_TIMEOUT_FRAMES;
+    uint64_t elapsed_time = get_monotonic_time() - presentation_time;
+    if (elapsed_time >= timeout)
+    {
+        presentation_pending = false;
+        return false;
+    }
+
+    // Try again once the presentation times out.
+    request_deferred_update(timeout - elapsed_time);
+    return true;
+}
+
+void handle_presentation_error(XErrorEvent *error)
+{
+    // Ensure the error was caused by the pending presentation.
+    if (!presentation_pending) return;
+    if (error->serial != presentation_request) return;
+
+    // Stop waiting for it, as a failed presentation never completes.
+    presentation_pending = false;
+    request_update();
+}
+
 HANDLE(Update)
 {
+    // Wait for the previous frame to be displayed before drawing to the
+    // buffer again, keeping the queued geometry changes for the next frame.
+    // Its completion requests another update.
+    if (is_presentation_pending()) return;
+
+    // Measure the frame, including the geometry changes it reflects.
+    begin_frame_measurement();
+
+    // Send the queued portal geometry changes, so the frame reflects them.
+    flush_portal_configures();
+
     compositor_redraw();
 }
+
+HANDLE(FramePresented)
+{
+    // Ensure the presentation is the one being waited for.
+    if (!presentation_pending) return;
+    if (event->frame_presented.serial != presentation_serial) return;
+    presentation_pending = false;
+
+    // Draw the next frame if anything changed in the meantime.
+    if (!damage_enabled || !cairo_region_is_empty(get_damage_region()))
+    {
+        request_update();
+    }
+}
+
+HANDLE(PortalInitialized)
+{
+    Portal *portal = event->portal_initialized.portal;
+
+    // Determine which parts of the client are opaque.
+    update_portal_opaque_region(portal);
+
+    // Determine whether the client wants the compositor bypassed.
+    portal->bypass_compositor = x_get_window_bypass_compositor(DefaultDisplay, portal->client_window);
+}
+
+HANDLE(PropertyNotify)
+{
+    XPropertyEvent *_event = &event->xproperty;
+    Display *display = DefaultDisplay;
+
+    // Ensure the property change is related to the opaque region or the
+    // compositor bypass hint.
+    Atom _NET_WM_OPAQUE_REGION = XInternAtom(display, "_NET_WM_OPAQUE_REGION", False);
+    Atom _NET_WM_BYPASS_COMPOSITOR = XInternAtom(display, "_NET_WM_BYPASS_COMPOSITOR", False);
+    if (_event->atom != _NET_WM_OPAQUE_REGION && _event->atom != _NET_WM_BYPASS_COMPOSITOR) return;
+
+    // Ensure the property change is related to a client window.
+    Portal *portal = find_portal_by_window(_event->window);
+    if (portal == NULL || portal->client_window != _event->window) return;
+
+    // Update the changed property.
+    if (_event->atom == _NET_WM_OPAQUE_REGION)
+    {
+        update_portal_opaque_region(portal);
+    }
+    else
+    {
+        portal->bypass_compositor = x_get_window_bypass_compositor(display, portal->client_window);
+    }
+
+    // Repaint the portal, which also reconsiders bypassing the compositor.
+    add_portal_damage(portal);
+}
+
+HANDLE(PortalMapped)
+{
+    Portal *portal = event->portal_mapped.portal;
+
+    // Mapping allocates a new window pixmap, so name it again when drawn.
+    release_portal_pixmap(portal);
+
+    // Ensure the portal doesn't already have a damage object.
+    if (!compositor_enabled || !damage_enabled) return;
+    if (portal->damage != None) return;
+
+    // Track content changes of the composited window (frame if it exists,
+    // otherwise client). The window may already be gone again.
+    Display *display = DefaultDisplay;
+    Window target_window = (portal->frame_window != None) ?
+        portal->frame_window : portal->client_window;
+    x_begin_ignoring_errors(display);
+    portal->damage = XDamageCreate(display, target_window, XDamageReportBoundingBox);
+    x_end_ignoring_errors(display);
+}
+
+HANDLE(PortalUnmapped)
+{
+    // Unmapped windows have no pixmap worth keeping around.
+    release_portal_pixmap(event->portal_unmapped.portal);
+}
+
+HANDLE(PortalTransformed)
+{
+    Portal *portal = event->portal_transformed.portal;
+    if (portal->window_surface == NULL) return;
+
+    // Resizing allocates a new window pixmap, while moving keeps it intact.
+    cairo_surface_t *surface = portal->window_surface;
+    if (cairo_xlib_surface_get_width(surface) != (int)portal->width ||
+        cairo_xlib_surface_get_height(surface) != (int)portal->height)
+    {
+        release_portal_pixmap(portal);
+    }
+}
+
+HANDLE(PortalDestroyed)
+{
+    Portal *portal = event->portal_destroyed.portal;
+
+    // Free the cached window pixmap.
+    release_portal_pixmap(portal);
+
+    // The damage object is freed by the server together with its window, so
+    // only forget about it here.
+    portal->damage = None;
+
+    // Free the opaque region.
+    if (portal->opaque_region != NULL)
+    {
+        cairo_region_destroy(portal->opaque_region);
+        portal->opaque_region = NULL;
+    }
+}
@@ -1,2 +1,12 @@
 #pragma once
 #include "../all.h"
+
+/**
+ * Stops waiting for the pending presentation, if the given error was caused
+ * by its request.
+ *
+ * @param error The error reported by the X server.
+ *
+ * @note Called from the X error handler, so it only updates state.
+ */
+void handle_presentation_error(XErrorEvent *error);
@@ -0,0 +1,146 @@
+/**
+ * This code is responsible for tracking damaged areas of the screen.
+ *
+ * Damage is accumulated in a single region between compositor redraws, so
+ * that only the areas which actually changed are repainted and copied to the
+ * root window. Content changes are reported by the XDamage extension, while
+ * geometry and stacking changes are derived from portal events.
+ *
+ * Adding damage is what schedules the next compositor redraw, so the event
+ * loop stays asleep while nothing on screen changes.
+ */
+
+#include "../all.h"
+
+static cairo_region_t *damage_region = NULL;
+
+static int screen_width = 0;
+static int screen_height = 0;
+
+void add_damage(int x, int y, int width, int height)
+{
+    // Ensure the damage region exists.
+    if (damage_region == NULL) return;
+
+    // Ignore empty areas.
+    if (width <= 0 || height <= 0) return;
+
+    // Add the area to the damage region.
+    cairo_rectangle_int_t area = { x, y, width, height };
+    cairo_region_union_rectangle(damage_region, &area);
+
+    // Schedule a redraw to repair the damage.
+    request_update();
+}
+
+void add_screen_damage()
+{
+    add_damage(0, 0, screen_width, screen_height);
+}
+
+cairo_rectangle_int_t get_portal_composited_bounds(Portal *portal)
+{
+    // Framed portals cast a shadow beyond their geometry.
+    int extent = (portal->frame_window != None) ? PORTAL_SHADOW_EXTENT : 0;
+
+    return (cairo_rectangle_int_t){
+        portal->x_root - extent,
+        portal->y_root - extent,
+        (int)portal->width + 2 * extent,
+        (int)portal->height + 2 * extent
+    };
+}
+
+void add_portal_damage(Portal *portal)
+{
+    // Damage the area the portal was last composited to.
+    cairo_rectangle_int_t previous = portal->composited_bounds;
+    add_damage(previous.x, previous.y, previous.width, previous.height);
+
+    // Damage the area the portal currently occupies.
+    cairo_rectangle_int_t current = get_portal_composited_bounds(portal);
+    add_damage(current.x, current.y, current.width, current.height);
+}
+
+cairo_region_t *get_damage_region()
+{
+    return damage_region;
+}
+
+void clear_damage()
+{
+    // Ensure the damage region exists.
+    if (damage_region == NULL) return;
+
+    // Empty the damage region in place by intersecting it with nothing.
+    cairo_region_intersect_rectangle(damage_region, &(cairo_rectangle_int_t){ 0, 0, 0, 0 });
+}
+
+HANDLE(Initialize)
+{
+    Display *display = DefaultDisplay;
+    int screen = DefaultScreen(display);
+
+    // Get screen dimensions.
+    screen_width = DisplayWidth(display, screen);
+    screen_height = DisplayHeight(display, screen);
+
+    // Create the damage region, and damage the entire screen so the first
+    // frame is painted in full.
+    damage_region = cairo_region_create();
+    add_screen_damage();
+}
+
+HANDLE(PortalDamaged)
+{
+    PortalDamagedEvent *_event = &event->portal_damaged;
+    Portal *portal = _event->portal;
+    if (portal == NULL || portal->damage == None) return;
+
+    // Acknowledge the damage, so the server reports further changes. The
+    // damage object is gone if its window was destroyed in the meantime.
+    Display *display = DefaultDisplay;
+    x_begin_ignoring_errors(display);
+    XDamageSubtract(display, portal->damage, None, None);
+    x_end_ignoring_errors(display);
+
+    // Damage the changed area, translated to root coordinates.
+    if (!portal->mapped) return;
+    add_damage(
+        portal->x_root + _event->x_portal,
+        portal->y_root + _event->y_portal,
+        _event->width,
+        _event->height
+    );
+}
+
+HANDLE(PortalMapped)
+{
+    add_portal_damage(event->portal_mapped.portal);
+}
+
+HANDLE(PortalUnmapped)
+{
+    add_portal_damage(event->portal_unmapped.portal);
+}
+
+HANDLE(PortalTransformed)
+{
+    add_portal_damage(event->portal_transformed.portal);
+}
+
+HANDLE(PortalRaised)
+{
+    add_portal_damage(event->portal_raised.portal);
+}
+
+HANDLE(PortalDestroyed)
+{
+    add_portal_damage(event->portal_destroyed.portal);
+}
+
+HANDLE(ThemeChanged)
+{
+    // Border colors depend on the theme, so every portal needs repainting.
+    add_screen_damage();
+}
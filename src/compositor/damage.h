@@ -0,0 +1,51 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Marks an area of the screen as damaged, so it gets repainted and copied to
+ * the root window during the next compositor redraw.
+ *
+ * @param x The X coordinate relative to root.
+ * @param y The Y coordinate relative to root.
+ * @param width The width of the area in pixels.
+ * @param height The height of the area in pixels.
+ *
+ * @note Requests an Update event, which triggers the next compositor redraw.
+ */
+void add_damage(int x, int y, int width, int height);
+
+/**
+ * Marks the entire screen as damaged.
+ */
+void add_screen_damage();
+
+/**
+ * Marks both the area a portal was last composited to and the area it
+ * currently occupies as damaged.
+ *
+ * @param portal The portal whose areas should be damaged.
+ */
+void add_portal_damage(Portal *portal);
+
+/**
+ * Calculates the area of the screen a portal covers when composited,
+ * including decorations that extend beyond its geometry, such as shadows.
+ *
+ * @param portal The portal to calculate the area for.
+ *
+ * @return The composited area, relative to root.
+ */
+cairo_rectangle_int_t get_portal_composited_bounds(Portal *portal);
+
+/**
+ * Retrieves the region of the screen that has been damaged since the last
+ * call to `clear_damage()`.
+ *
+ * @return The damaged region, owned by the damage module.
+ */
+cairo_region_t *get_damage_region();
+
+/**
+ * Clears all accumulated damage, typically after a frame has been presented.
+ */
+void clear_damage();
@@ -3,37 +3,179 @@
  *
  * It handles rendering drop shadows for portals, creating a multi-layer soft
  * shadow effect for visual depth.
+ *
+ * The shadow is rendered once around a minimal portal into a cached nine-slice
+ * surface. Drawing a shadow then only composites the four corners as they are,
+ * and stretches the four edges along the sides of the portal. The center slice
+ * is never drawn, as it lies underneath the opaque portal content.
  */
 
 #include "../all.h"
 
-void draw_portal_shadow(cairo_t *cr, Portal *portal)
+typedef struct {
+    int spread;
+    int radius;
+    double opacity;
+    int corner_size;
+    cairo_surface_t *surface;
+} ShadowSlices;
+
+static ShadowSlices shadow_slices = {
+    .spread = 0,
+    .radius = 0,
+    .opacity = 0,
+    .corner_size = 0,
+    .surface = NULL
+};
+
+static void render_shadow_layers(cairo_t *cr, double x, double y,
+    double width, double height, int spread, int radius, double opacity)
 {
-    // Define the shadow parameters.
+    // Define the layer count.
     int shadow_layers = 4;
-    double shadow_offset_x = 0;
-    double shadow_offset_y = 0;
-    double shadow_spread = 20;
-    double shadow_opacity = 0.1;
 
     // Draw each shadow layer from outermost to innermost.
     for (int layer = shadow_layers; layer > 0; layer--)
     {
         // Calculate the layer-specific values.
         double factor = (double)layer / shadow_layers;
-        double offset_x = shadow_offset_x * factor;
-        double offset_y = shadow_offset_y * factor;
-        double spread = shadow_spread * factor;
-        double opacity = (shadow_opacity / shadow_layers) * (1.0 - factor * 0.5);
+        double layer_spread = spread * factor;
+        double layer_opacity = (opacity / shadow_layers) * (1.0 - factor * 0.5);
 
         // Draw the shadow layer.
-        cairo_set_source_rgba(cr, 0, 0, 0, opacity);
+        cairo_set_source_rgba(cr, 0, 0, 0, layer_opacity);
         cairo_rounded_rectangle(cr,
-            portal->x_root + offset_x - spread / 2,
-            portal->y_root + offset_y - spread / 2,
-            portal->width + spread,
-            portal->height + spread,
-            PORTAL_CORNER_RADIUS + spread / 2);
+            x - layer_spread / 2,
+            y - layer_spread / 2,
+            width + layer_spread,
+            height + layer_spread,
+            radius + layer_spread / 2);
         cairo_fill(cr);
     }
 }
+
+static ShadowSlices *get_shadow_slices(cairo_t *cr, int spread, int radius, double opacity)
+{
+    // Reuse the cached slices if they were rendered with the same parameters.
+    if (shadow_slices.surface != NULL &&
+        shadow_slices.spread == spread &&
+        shadow_slices.radius == radius &&
+        shadow_slices.opacity == opacity)
+    {
+        return &shadow_slices;
+    }
+
+    // Release the outdated slices.
+    if (shadow_slices.surface != NULL)
+    {
+        cairo_surface_destroy(shadow_slices.surface);
+        shadow_slices.surface = NULL;
+    }
+
+    // Determine the slice dimensions. Corners span from the outer edge of the
+    // shadow to the end of the rounded corner of the portal, leaving a single
+    // pixel in between to be stretched.
+    int extent = spread / 2;
+    int corner_size = extent + radius;
+    int surface_size = corner_size * 2 + 1;
+
+    // Create the surface on the same server as the target, so drawing the
+    // slices doesn't upload them on every frame.
+    cairo_surface_t *surface = cairo_surface_create_similar(
+        cairo_get_target(cr),
+        CAIRO_CONTENT_COLOR_ALPHA,
+        surface_size,
+        surface_size
+    );
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(surface);
+        return NULL;
+    }
+
+    // Render the shadow around the smallest portal with intact corners.
+    cairo_t *slices_cr = cairo_create(surface);
+    render_shadow_layers(slices_cr, extent, extent,
+        radius * 2 + 1, radius * 2 + 1, spread, radius, opacity);
+    cairo_destroy(slices_cr);
+
+    // Cache the slices together with their parameters.
+    shadow_slices = (ShadowSlices){
+        .spread = spread,
+        .radius = radius,
+        .opacity = opacity,
+        .corner_size = corner_size,
+        .surface = surface
+    };
+
+    return &shadow_slices;
+}
+
+static void draw_shadow_slice(cairo_t *cr, cairo_surface_t *surface,
+    int source_x, int source_y, int source_width, int source_height,
+    int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0) return;
+
+    // Map the slice onto the destination rectangle, stretching it if the
+    // dimensions differ.
+    cairo_pattern_t *pattern = cairo_pattern_create_for_surface(surface);
+    cairo_matrix_t matrix;
+    cairo_matrix_init_translate(&matrix, source_x, source_y);
+    cairo_matrix_scale(&matrix,
+        (double)source_width / width,
+        (double)source_height / height);
+    cairo_matrix_translate(&matrix, -x, -y);
+    cairo_pattern_set_matrix(pattern, &matrix);
+    cairo_pattern_set_filter(pattern, CAIRO_FILTER_NEAREST);
+
+    // Fill the destination rectangle with the slice.
+    cairo_set_source(cr, pattern);
+    cairo_rectangle(cr, x, y, width, height);
+    cairo_fill(cr);
+    cairo_pattern_destroy(pattern);
+}
+
+void draw_portal_shadow(cairo_t *cr, Portal *portal)
+{
+    // Define the shadow parameters.
+    int shadow_spread = PORTAL_SHADOW_SPREAD;
+    int shadow_radius = PORTAL_CORNER_RADIUS;
+    double shadow_opacity = 0.1;
+
+    // Get the pre-rendered shadow slices.
+    ShadowSlices *slices = get_shadow_slices(cr, shadow_spread, shadow_radius, shadow_opacity);
+    if (slices == NULL) return;
+
+    // Determine the outer bounds of the shadow and the slice dimensions.
+    int extent = shadow_spread / 2;
+    int corner = slices->corner_size;
+    int left = portal->x_root - extent;
+    int top = portal->y_root - extent;
+    int right = portal->x_root + (int)portal->width + extent;
+    int bottom = portal->y_root + (int)portal->height + extent;
+    int edge_width = (right - left) - corner * 2;
+    int edge_height = (bottom - top) - corner * 2;
+    int far = corner + 1;
+    cairo_surface_t *surface = slices->surface;
+
+    // Draw the corners.
+    draw_shadow_slice(cr, surface, 0, 0, corner, corner,
+        left, top, corner, corner);
+    draw_shadow_slice(cr, surface, far, 0, corner, corner,
+        right - corner, top, corner, corner);
+    draw_shadow_slice(cr, surface, 0, far, corner, corner,
+        left, bottom - corner, corner, corner);
+    draw_shadow_slice(cr, surface, far, far, corner, corner,
+        right - corner, bottom - corner, corner, corner);
+
+    // Draw the edges, stretched between the corners.
+    draw_shadow_slice(cr, surface, corner, 0, 1, corner,
+        left + corner, top, edge_width, corner);
+    draw_shadow_slice(cr, surface, corner, far, 1, corner,
+        left + corner, bottom - corner, edge_width, corner);
+    draw_shadow_slice(cr, surface, 0, corner, corner, 1,
+        left, top + corner, corner, edge_height);
+    draw_shadow_slice(cr, surface, far, corner, corner, 1,
+        right - corner, top + corner, corner, edge_height);
+}
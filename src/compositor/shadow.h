@@ -1,12 +1,21 @@
 #pragma once
 #include "../all.h"
 
+/** The spread of a portal shadow in pixels. */
+#define PORTAL_SHADOW_SPREAD 20
+
+/** The distance in pixels that a portal shadow extends beyond its portal. */
+#define PORTAL_SHADOW_EXTENT (PORTAL_SHADOW_SPREAD / 2)
+
 /**
  * Draws a drop shadow for a portal.
  *
  * Renders a multi-layer soft shadow effect behind the portal to create
  * depth and visual separation from the background.
  *
+ * @note The shadow is composited from a nine-slice surface which is rendered
+ * once and cached. The area underneath the portal is left untouched.
+ *
  * @param cr The Cairo context to draw on.
  * @param portal The portal to draw the shadow for.
  */
@@ -56,7 +56,27 @@ static const char default_config[] =
     CFG_KEY_EXIT_SHORTCUT "=" CFG_DEFAULT_EXIT_SHORTCUT "\n"
     "\n"
     "# The shortcut used to close the focused window.\n"
-    CFG_KEY_CLOSE_SHORTCUT "=" CFG_DEFAULT_CLOSE_SHORTCUT "\n";
+    CFG_KEY_CLOSE_SHORTCUT "=" CFG_DEFAULT_CLOSE_SHORTCUT "\n"
+    "\n"
+    "# ---\n"
+    "# Diagnostics\n"
+    "# --- \n"
+    "\n"
+    "# Whether to measure the latency from input to screen (0 or 1).\n"
+    "# The statistics are logged when receiving the SIGUSR1 signal.\n"
+    CFG_KEY_LATENCY_STATISTICS "=" CFG_DEFAULT_LATENCY_STATISTICS "\n"
+    "\n"
+    "# Whether to measure the time spent in each event handler (0 or 1).\n"
+    "# The measurements are logged when receiving the SIGUSR1 signal.\n"
+    CFG_KEY_HANDLER_PROFILING "=" CFG_DEFAULT_HANDLER_PROFILING "\n"
+    "\n"
+    "# Whether to measure the time and X requests of each frame (0 or 1).\n"
+    "# The statistics are logged when receiving the SIGUSR1 signal.\n"
+    CFG_KEY_FRAME_STATISTICS "=" CFG_DEFAULT_FRAME_STATISTICS "\n"
+    "\n"
+    "# Whether to record the most recent events for replaying (0 or 1).\n"
+    "# The trace is written to /tmp when receiving the SIGUSR2 signal.\n"
+    CFG_KEY_EVENT_TRACE "=" CFG_DEFAULT_EVENT_TRACE "\n";
 // clang-format on
 
 static void create_config_directory(const char *path)
@@ -100,6 +100,42 @@
         CFG_KEY_CLOSE_SHORTCUT, \
         CFG_DEFAULT_CLOSE_SHORTCUT
 
+// Configuration field constants (latency_statistics).
+#define CFG_TYPE_LATENCY_STATISTICS int
+#define CFG_KEY_LATENCY_STATISTICS "latency_statistics"
+#define CFG_DEFAULT_LATENCY_STATISTICS "0"
+#define CFG_BUNDLE_LATENCY_STATISTICS \
+        CFG_TYPE_LATENCY_STATISTICS, \
+        CFG_KEY_LATENCY_STATISTICS, \
+        CFG_DEFAULT_LATENCY_STATISTICS
+
+// Configuration field constants (handler_profiling).
+#define CFG_TYPE_HANDLER_PROFILING int
+#define CFG_KEY_HANDLER_PROFILING "handler_profiling"
+#define CFG_DEFAULT_HANDLER_PROFILING "0"
+#define CFG_BUNDLE_HANDLER_PROFILING \
+        CFG_TYPE_HANDLER_PROFILING, \
+        CFG_KEY_HANDLER_PROFILING, \
+        CFG_DEFAULT_HANDLER_PROFILING
+
+// Configuration field constants (event_trace).
+#define CFG_TYPE_EVENT_TRACE int
+#define CFG_KEY_EVENT_TRACE "event_trace"
+#define CFG_DEFAULT_EVENT_TRACE "0"
+#define CFG_BUNDLE_EVENT_TRACE \
+        CFG_TYPE_EVENT_TRACE, \
+        CFG_KEY_EVENT_TRACE, \
+        CFG_DEFAULT_EVENT_TRACE
+
+// Configuration field constants (frame_statistics).
+#define CFG_TYPE_FRAME_STATISTICS int
+#define CFG_KEY_FRAME_STATISTICS "frame_statistics"
+#define CFG_DEFAULT_FRAME_STATISTICS "0"
+#define CFG_BUNDLE_FRAME_STATISTICS \
+        CFG_TYPE_FRAME_STATISTICS, \
+        CFG_KEY_FRAME_STATISTICS, \
+        CFG_DEFAULT_FRAME_STATISTICS
+
 /**
  * Retrieves a configuration value from the loaded configuration entries.
  * Intended to be used for configuration values of type `str`.
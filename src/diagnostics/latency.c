@@ -0,0 +1,236 @@
+/**
+ * This code is responsible for measuring input-to-screen latency.
+ *
+ * Raw input events are timestamped when they are read from the event queue.
+ * While such an event is handled, any requested frame is attributed to it,
+ * and once the compositor flushes that frame, the time since the earliest
+ * attributed event is recorded.
+ *
+ * Latencies are recorded per input kind into log-linear histograms, where
+ * every power of two is split into equally sized buckets. This keeps the
+ * relative error of the reported percentiles constant at any magnitude. The
+ * statistics are logged when the window manager receives `SIGUSR1`.
+ *
+ * Tracking is disabled unless enabled through the configuration.
+ */
+
+#include "../all.h"
+
+/** The number of buckets every power of two is split into, as a power of two. */
+#define LATENCY_SUB_BUCKET_BITS 3
+
+/** The number of buckets every power of two is split into. */
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+
+/** The number of buckets covering all 64-bit latencies. */
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef enum {
+    INPUT_KIND_NONE = -1,
+    INPUT_KIND_MOTION,
+    INPUT_KIND_BUTTON,
+    INPUT_KIND_KEY,
+    INPUT_KIND_COUNT
+} InputKind;
+
+typedef struct {
+    uint64_t buckets[LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+} LatencyHistogram;
+
+static const char *input_kind_names[INPUT_KIND_COUNT] = {
+    [INPUT_KIND_MOTION] = "pointer motion",
+    [INPUT_KIND_BUTTON] = "pointer button",
+    [INPUT_KIND_KEY] = "key"
+};
+
+static bool latency_enabled = false;
+
+// Tracks the input event being handled.
+static InputAttribution current_attribution = {
+    .kind = INPUT_KIND_NONE,
+    .time = 0
+};
+
+// Tracks the earliest input of each kind attributed to the next frame.
+static uint64_t frame_input_times[INPUT_KIND_COUNT];
+
+static LatencyHistogram histograms[INPUT_KIND_COUNT];
+
+static unsigned int get_bucket_index(uint64_t value)
+{
+    // Small values each get their own bucket.
+    if (value < LATENCY_SUB_BUCKETS) return value;
+
+    // Larger values are bucketed by their power of two, and the bits right
+    // below the most significant one.
+    int shift = (63 - __builtin_clzll(value)) - LATENCY_SUB_BUCKET_BITS;
+    unsigned int sub_bucket = (value >> shift) - LATENCY_SUB_BUCKETS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + sub_bucket;
+}
+
+static uint64_t get_bucket_upper_bound(unsigned int index)
+{
+    if (index < LATENCY_SUB_BUCKETS) return index;
+
+    int shift = index / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = index % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+static uint64_t get_histogram_percentile(LatencyHistogram *histogram, double percentile)
+{
+    // Find the bucket containing the requested rank.
+    uint64_t rank = (uint64_t)(histogram->count * percentile);
+    if (rank >= histogram->count) rank = histogram->count - 1;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen > rank)
+        {
+            // Report the upper bound of the bucket, but never beyond the max.
+            uint64_t bound = get_bucket_upper_bound(i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+static void log_latency_statistics()
+{
+    for (int kind = 0; kind < INPUT_KIND_COUNT; kind++)
+    {
+        LatencyHistogram *histogram = &histograms[kind];
+        if (histogram->count == 0)
+        {
+            LOG_INFO("Input latency (%s): no samples.", input_kind_names[kind]);
+            continue;
+        }
+
+        // Latencies are recorded in microseconds.
+        LOG_INFO(
+            "Input latency (%s): %llu samples, p50 %.2f ms, p99 %.2f ms, max %.2f ms.",
+            input_kind_names[kind],
+            (unsigned long long)histogram->count,
+            get_histogram_percentile(histogram, 0.50) / 1000.0,
+            get_histogram_percentile(histogram, 0.99) / 1000.0,
+            histogram->max / 1000.0
+        );
+    }
+}
+
+static InputKind get_input_kind(Event *event)
+{
+    switch (event->type)
+    {
+        case RawMotionNotify: return INPUT_KIND_MOTION;
+        case RawButtonPress: return INPUT_KIND_BUTTON;
+        case RawButtonRelease: return INPUT_KIND_BUTTON;
+        case RawKeyPress: return INPUT_KIND_KEY;
+        case RawKeyRelease: return INPUT_KIND_KEY;
+        default: return INPUT_KIND_NONE;
+    }
+}
+
+static uint64_t get_input_dequeue_time(Event *event)
+{
+    switch (event->type)
+    {
+        case RawMotionNotify: return event->raw_motion_notify.dequeue_time;
+        case RawButtonPress: return event->raw_button_press.dequeue_time;
+        case RawButtonRelease: return event->raw_button_release.dequeue_time;
+        case RawKeyPress: return event->raw_key_press.dequeue_time;
+        case RawKeyRelease: return event->raw_key_release.dequeue_time;
+        default: return 0;
+    }
+}
+
+uint64_t get_input_timestamp()
+{
+    return latency_enabled ? get_monotonic_time() : 0;
+}
+
+InputAttribution begin_input_attribution(Event *event)
+{
+    InputAttribution previous_attribution = current_attribution;
+    if (!latency_enabled) return previous_attribution;
+
+    // Attribute to the event, if it's a timestamped input event.
+    InputKind kind = get_input_kind(event);
+    uint64_t dequeue_time = get_input_dequeue_time(event);
+    if (kind != INPUT_KIND_NONE && dequeue_time != 0)
+    {
+        current_attribution = (InputAttribution){
+            .kind = kind,
+            .time = dequeue_time
+        };
+    }
+
+    return previous_attribution;
+}
+
+void end_input_attribution(InputAttribution previous_attribution)
+{
+    current_attribution = previous_attribution;
+}
+
+void attribute_frame_to_input()
+{
+    if (!latency_enabled) return;
+    if (current_attribution.kind == INPUT_KIND_NONE) return;
+
+    // Keep the earliest input of each kind, as it waited the longest.
+    uint64_t *frame_input_time = &frame_input_times[current_attribution.kind];
+    if (*frame_input_time == 0 || current_attribution.time < *frame_input_time)
+    {
+        *frame_input_time = current_attribution.time;
+    }
+}
+
+void record_frame_latency()
+{
+    if (!latency_enabled) return;
+
+    uint64_t now = get_monotonic_time();
+    for (int kind = 0; kind < INPUT_KIND_COUNT; kind++)
+    {
+        if (frame_input_times[kind] == 0) continue;
+
+        // Record the latency in microseconds.
+        uint64_t latency = (now - frame_input_times[kind]) / 1000;
+        LatencyHistogram *histogram = &histograms[kind];
+        histogram->buckets[get_bucket_index(latency)]++;
+        histogram->count++;
+        if (latency > histogram->max) histogram->max = latency;
+
+        frame_input_times[kind] = 0;
+    }
+}
+
+void discard_frame_latency()
+{
+    for (int kind = 0; kind < INPUT_KIND_COUNT; kind++)
+    {
+        frame_input_times[kind] = 0;
+    }
+}
+
+HANDLE(Initialize)
+{
+    int latency_statistics;
+    GET_CONFIG(&latency_statistics, sizeof(latency_statistics), CFG_BUNDLE_LATENCY_STATISTICS);
+    latency_enabled = (latency_statistics != 0);
+}
+
+HANDLE(SignalReceived)
+{
+    SignalReceivedEvent *_event = &event->signal_received;
+
+    if (_event->signal_number != SIGUSR1) return;
+    if (!latency_enabled) return;
+
+    log_latency_statistics();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * The input event that everything requested is attributed to, as the kind of
+ * input and the time it was read from the event queue.
+ */
+typedef struct {
+    int kind;
+    uint64_t time;
+} InputAttribution;
+
+/**
+ * Retrieves the timestamp of an input event read from the event queue.
+ *
+ * @return - `> 0` The current monotonic time in nanoseconds.
+ * @return - `0` Latency tracking is disabled.
+ */
+uint64_t get_input_timestamp();
+
+/**
+ * Marks the start of handling an event. If it's an input event, everything
+ * requested while handling it is attributed to it.
+ *
+ * @param event The event about to be handled.
+ *
+ * @return The input attribution to restore once the event is handled.
+ *
+ * @note Events handled from within other event handlers inherit the input
+ * attribution of the outer event.
+ */
+InputAttribution begin_input_attribution(Event *event);
+
+/**
+ * Marks the end of handling an event.
+ *
+ * @param previous_attribution The value returned by `begin_input_attribution`.
+ */
+void end_input_attribution(InputAttribution previous_attribution);
+
+/**
+ * Attributes the next frame to the input event currently being handled, if
+ * any.
+ */
+void attribute_frame_to_input();
+
+/**
+ * Records the latency of every input event the flushed frame was attributed
+ * to, measured from when the input event was read from the event queue.
+ */
+void record_frame_latency();
+
+/**
+ * Drops the input attributed to the next frame, for when it won't be shown
+ * by the window manager.
+ */
+void discard_frame_latency();
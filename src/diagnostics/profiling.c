@@ -0,0 +1,30 @@
+/**
+ * This code is responsible for enabling event handler profiling.
+ *
+ * Profiling is disabled unless enabled through the configuration. Once
+ * enabled, the measurements of all event handlers are logged when the window
+ * manager receives `SIGUSR1`.
+ */
+
+#include "../all.h"
+
+static bool profiling_enabled = false;
+
+HANDLE(Initialize)
+{
+    int handler_profiling;
+    GET_CONFIG(&handler_profiling, sizeof(handler_profiling), CFG_BUNDLE_HANDLER_PROFILING);
+    profiling_enabled = (handler_profiling != 0);
+
+    if (profiling_enabled) enable_event_handler_profiling();
+}
+
+HANDLE(SignalReceived)
+{
+    SignalReceivedEvent *_event = &event->signal_received;
+
+    if (_event->signal_number != SIGUSR1) return;
+    if (!profiling_enabled) return;
+
+    log_event_handler_profile();
+}
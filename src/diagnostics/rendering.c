@@ -0,0 +1,96 @@
+/**
+ * This code is responsible for measuring the cost of compositor frames.
+ *
+ * Measurements are disabled unless enabled through the configuration. Once
+ * enabled, the time spent drawing every frame and the number of X requests it
+ * sends are accumulated. They are logged when the window manager receives
+ * `SIGUSR1`, and reset afterwards, so every log covers the frames drawn since
+ * the previous one.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    bool enabled;
+    uint64_t start_time;
+    unsigned long start_request;
+    uint64_t frame_count;
+    uint64_t total_time;
+    uint64_t max_time;
+    uint64_t total_request_count;
+} FrameStatistics;
+
+static FrameStatistics frame_statistics = {
+    .enabled = false,
+    .start_time = 0,
+    .start_request = 0,
+    .frame_count = 0,
+    .total_time = 0,
+    .max_time = 0,
+    .total_request_count = 0
+};
+
+void begin_frame_measurement()
+{
+    if (!frame_statistics.enabled) return;
+
+    frame_statistics.start_time = get_monotonic_time();
+    frame_statistics.start_request = NextRequest(DefaultDisplay);
+}
+
+void record_frame_measurement()
+{
+    if (!frame_statistics.enabled) return;
+    if (frame_statistics.start_time == 0) return;
+
+    uint64_t elapsed_time = get_monotonic_time() - frame_statistics.start_time;
+    unsigned long request_count = NextRequest(DefaultDisplay) - frame_statistics.start_request;
+
+    // Accumulate the measurement.
+    frame_statistics.frame_count++;
+    frame_statistics.total_time += elapsed_time;
+    frame_statistics.total_request_count += request_count;
+    if (elapsed_time > frame_statistics.max_time) frame_statistics.max_time = elapsed_time;
+
+    frame_statistics.start_time = 0;
+}
+
+static void log_frame_statistics()
+{
+    uint64_t frame_count = frame_statistics.frame_count;
+    if (frame_count == 0)
+    {
+        LOG_INFO("Frame statistics: 0 frames.");
+        return;
+    }
+
+    // Log the means and the worst case, with times in microseconds.
+    LOG_INFO("Frame statistics: %llu frames, mean time %.1f us, worst time %.1f us, mean requests %.1f.",
+        (unsigned long long)frame_count,
+        frame_statistics.total_time / (double)frame_count / 1000.0,
+        frame_statistics.max_time / 1000.0,
+        frame_statistics.total_request_count / (double)frame_count);
+}
+
+HANDLE(Initialize)
+{
+    int enabled;
+    GET_CONFIG(&enabled, sizeof(enabled), CFG_BUNDLE_FRAME_STATISTICS);
+    frame_statistics.enabled = (enabled != 0);
+}
+
+HANDLE(SignalReceived)
+{
+    SignalReceivedEvent *_event = &event->signal_received;
+
+    if (_event->signal_number != SIGUSR1) return;
+    if (!frame_statistics.enabled) return;
+
+    log_frame_statistics();
+
+    // Start over, so the next log only covers the frames drawn until then.
+    frame_statistics.frame_count = 0;
+    frame_statistics.total_time = 0;
+    frame_statistics.max_time = 0;
+    frame_statistics.total_request_count = 0;
+}
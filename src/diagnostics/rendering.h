@@ -0,0 +1,17 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Marks the start of a frame, from which its time and X requests are
+ * measured.
+ *
+ * @note Frames which turn out not to be drawn are never recorded, and the
+ * next call starts over.
+ */
+void begin_frame_measurement();
+
+/**
+ * Records the time and the number of X requests of the frame started by
+ * `begin_frame_measurement`, once it was flushed to the X server.
+ */
+void record_frame_measurement();
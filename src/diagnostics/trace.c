@@ -0,0 +1,468 @@
+/**
+ * This code is responsible for recording and replaying event traces.
+ *
+ * When enabled, every event dispatched by the event loop is recorded into a
+ * ring buffer, along with the pointer positions queried while handling it.
+ * The buffer is written to a trace file when the window manager receives
+ * `SIGUSR2`, so it always holds the most recent interaction.
+ *
+ * A trace is replayed by starting the window manager with `--replay <path>`,
+ * typically against an Xvfb server. Recorded events are then handled as fast
+ * as possible instead of the events of the X server, and the time spent per
+ * event type is logged once the trace ends. Windows created in the trace are
+ * stood in for by empty windows of the same geometry, and feedback about
+ * rendering is taken from the X server, as it can't be replayed.
+ */
+
+#include "../all.h"
+
+/** The number of records kept by the recorder. */
+#define EVENT_TRACE_CAPACITY 32768
+
+/** The number of event types timed during a replay. */
+#define EVENT_TRACE_TYPES 256
+
+/** The identifier at the start of every trace file. */
+#define EVENT_TRACE_MAGIC "LWMTRACE"
+
+/** The version of the trace file format. */
+#define EVENT_TRACE_VERSION 1
+
+typedef enum {
+    TRACE_RECORD_EVENT,
+    TRACE_RECORD_POINTER
+} TraceRecordKind;
+
+typedef struct {
+    uint32_t kind;
+    int32_t x_root, y_root;
+    uint64_t time;
+    Event event;
+} TraceRecord;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t root_window;
+    uint64_t record_count;
+} TraceHeader;
+
+typedef struct {
+    TraceRecord *records;
+    unsigned int next;
+    unsigned int count;
+} TraceRecorder;
+
+typedef struct {
+    Window traced_window;
+    Window live_window;
+} ReplayWindow;
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_time;
+    uint64_t max_time;
+} ReplayTiming;
+
+typedef struct {
+    TraceRecord *records;
+    uint64_t record_count;
+    uint64_t position;
+    Window traced_root_window;
+    ReplayWindow *windows;
+    unsigned int window_count;
+    unsigned int window_capacity;
+    ReplayTiming timings[EVENT_TRACE_TYPES];
+    uint64_t start_time;
+} TraceReplay;
+
+static TraceRecorder recorder = {
+    .records = NULL,
+    .next = 0,
+    .count = 0
+};
+
+static TraceReplay replay = {
+    .records = NULL,
+    .record_count = 0,
+    .position = 0,
+    .traced_root_window = None,
+    .windows = NULL,
+    .window_count = 0,
+    .window_capacity = 0,
+    .start_time = 0
+};
+
+static void add_trace_record(TraceRecord *record)
+{
+    // Overwrite the oldest record once the buffer is full.
+    recorder.records[recorder.next] = *record;
+    recorder.next = (recorder.next + 1) % EVENT_TRACE_CAPACITY;
+    if (recorder.count < EVENT_TRACE_CAPACITY) recorder.count++;
+}
+
+void record_traced_event(Event *event)
+{
+    if (recorder.records == NULL) return;
+
+    add_trace_record(&(TraceRecord){
+        .kind = TRACE_RECORD_EVENT,
+        .x_root = 0,
+        .y_root = 0,
+        .time = get_monotonic_time(),
+        .event = *event
+    });
+}
+
+void record_traced_pointer_position(int x_root, int y_root)
+{
+    if (recorder.records == NULL) return;
+
+    add_trace_record(&(TraceRecord){
+        .kind = TRACE_RECORD_POINTER,
+        .x_root = x_root,
+        .y_root = y_root,
+        .time = get_monotonic_time()
+    });
+}
+
+static void write_event_trace()
+{
+    // Name the trace after the process, so traces of different sessions
+    // don't overwrite each other.
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/tmp/limeos-window-manager-%d.trace", getpid());
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        LOG_ERROR("Could not write event trace (%s): %s", path, strerror(errno));
+        return;
+    }
+
+    // Write the header, describing the layout of the records.
+    TraceHeader header = {
+        .version = EVENT_TRACE_VERSION,
+        .record_size = sizeof(TraceRecord),
+        .root_window = DefaultRootWindow(DefaultDisplay),
+        .record_count = recorder.count
+    };
+    memcpy(header.magic, EVENT_TRACE_MAGIC, sizeof(header.magic));
+    fwrite(&header, sizeof(header), 1, file);
+
+    // Write the records from oldest to newest.
+    unsigned int first = (recorder.next + EVENT_TRACE_CAPACITY - recorder.count) % EVENT_TRACE_CAPACITY;
+    for (unsigned int i = 0; i < recorder.count; i++)
+    {
+        fwrite(&recorder.records[(first + i) % EVENT_TRACE_CAPACITY], sizeof(TraceRecord), 1, file);
+    }
+
+    fclose(file);
+    LOG_INFO("Wrote event trace with %u records (%s).", recorder.count, path);
+}
+
+int load_event_trace(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        LOG_ERROR("Could not open event trace (%s): %s", path, strerror(errno));
+        return -1;
+    }
+
+    // Ensure the trace was recorded by a compatible build, as records contain
+    // events as they are laid out in memory.
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, EVENT_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != EVENT_TRACE_VERSION ||
+        header.record_size != sizeof(TraceRecord))
+    {
+        LOG_ERROR("Could not load event trace (%s), unsupported format.", path);
+        fclose(file);
+        return -1;
+    }
+
+    // Read all records at once.
+    TraceRecord *records = malloc(header.record_count * sizeof(TraceRecord));
+    if (records == NULL && header.record_count > 0)
+    {
+        LOG_ERROR("Could not load event trace (%s), memory allocation failed.", path);
+        fclose(file);
+        return -1;
+    }
+    if (fread(records, sizeof(TraceRecord), header.record_count, file) != header.record_count)
+    {
+        LOG_ERROR("Could not load event trace (%s), file is truncated.", path);
+        free(records);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    replay.records = records;
+    replay.record_count = header.record_count;
+    replay.position = 0;
+    replay.traced_root_window = header.root_window;
+    return 0;
+}
+
+bool is_replaying_event_trace()
+{
+    return replay.records != NULL;
+}
+
+bool should_handle_live_event(Event *event)
+{
+    if (!is_replaying_event_trace()) return true;
+
+    return event->type == PortalDamaged ||
+           event->type == FramePresented ||
+           event->type == Expose;
+}
+
+static Window get_live_window(Window traced_window)
+{
+    if (traced_window == None) return None;
+    if (traced_window == replay.traced_root_window) return DefaultRootWindow(DefaultDisplay);
+
+    for (unsigned int i = 0; i < replay.window_count; i++)
+    {
+        if (replay.windows[i].traced_window == traced_window)
+        {
+            return replay.windows[i].live_window;
+        }
+    }
+
+    // Leave unknown windows as they are, requests on them fail harmlessly.
+    return traced_window;
+}
+
+static void create_stand_in_window(XCreateWindowEvent *create_event)
+{
+    Display *display = DefaultDisplay;
+
+    // Only stand in for windows created as children of root, as those are
+    // the windows that become portals.
+    if (create_event->parent != replay.traced_root_window) return;
+
+    // Grow the window map, if necessary.
+    if (replay.window_count >= replay.window_capacity)
+    {
+        unsigned int capacity = replay.window_capacity == 0 ? 16 : replay.window_capacity * 2;
+        ReplayWindow *windows = realloc(replay.windows, capacity * sizeof(ReplayWindow));
+        if (windows == NULL)
+        {
+            LOG_WARNING("Could not create stand-in window, memory allocation failed.");
+            return;
+        }
+        replay.windows = windows;
+        replay.window_capacity = capacity;
+    }
+
+    // Create an empty window with the recorded geometry.
+    Window live_window = XCreateWindow(
+        display,
+        DefaultRootWindow(display),
+        create_event->x, create_event->y,
+        create_event->width > 0 ? create_event->width : 1,
+        create_event->height > 0 ? create_event->height : 1,
+        0,
+        CopyFromParent,
+        InputOutput,
+        CopyFromParent,
+        CWOverrideRedirect,
+        &(XSetWindowAttributes){ .override_redirect = create_event->override_redirect }
+    );
+
+    replay.windows[replay.window_count] = (ReplayWindow){
+        .traced_window = create_event->window,
+        .live_window = live_window
+    };
+    replay.window_count++;
+}
+
+static bool prepare_replayed_event(Event *event)
+{
+    Display *display = DefaultDisplay;
+
+    // Skip events which can't be replayed. Damage refers to portals of the
+    // recorded session, and rendering feedback comes from the X server.
+    if (event->type == PortalDamaged ||
+        event->type == FramePresented ||
+        event->type == SignalReceived ||
+        event->type == Prepare ||
+        event->type == Initialize)
+    {
+        return false;
+    }
+
+    // Timestamp input events anew, as if they were just read from the queue.
+    if (event->type == RawMotionNotify) event->raw_motion_notify.dequeue_time = get_input_timestamp();
+    if (event->type == RawButtonPress) event->raw_button_press.dequeue_time = get_input_timestamp();
+    if (event->type == RawButtonRelease) event->raw_button_release.dequeue_time = get_input_timestamp();
+    if (event->type == RawKeyPress) event->raw_key_press.dequeue_time = get_input_timestamp();
+    if (event->type == RawKeyRelease) event->raw_key_release.dequeue_time = get_input_timestamp();
+
+    // Leave the remaining events of the window manager itself as they are.
+    if (event->type >= LASTEvent) return true;
+
+    // Stand in for windows created in the trace.
+    if (event->type == CreateNotify) create_stand_in_window(&event->xcreatewindow);
+
+    // Attach the event to this connection. Its serial is made the newest, so
+    // it is never mistaken for an outdated notification.
+    event->xany.display = display;
+    event->xany.serial = NextRequest(display);
+
+    // Translate the windows the event refers to.
+    event->xany.window = get_live_window(event->xany.window);
+    switch (event->type)
+    {
+        case CreateNotify:
+            event->xcreatewindow.window = get_live_window(event->xcreatewindow.window);
+            break;
+        case DestroyNotify:
+            event->xdestroywindow.window = get_live_window(event->xdestroywindow.window);
+            break;
+        case UnmapNotify:
+            event->xunmap.window = get_live_window(event->xunmap.window);
+            break;
+        case MapNotify:
+            event->xmap.window = get_live_window(event->xmap.window);
+            break;
+        case MapRequest:
+            event->xmaprequest.window = get_live_window(event->xmaprequest.window);
+            break;
+        case ConfigureNotify:
+            event->xconfigure.window = get_live_window(event->xconfigure.window);
+            event->xconfigure.above = get_live_window(event->xconfigure.above);
+            break;
+        case ConfigureRequest:
+            event->xconfigurerequest.window = get_live_window(event->xconfigurerequest.window);
+            event->xconfigurerequest.above = get_live_window(event->xconfigurerequest.above);
+            break;
+    }
+
+    return true;
+}
+
+static void log_replay_timings()
+{
+    uint64_t elapsed_time = get_monotonic_time() - replay.start_time;
+    uint64_t replayed_count = 0;
+    for (int type = 0; type < EVENT_TRACE_TYPES; type++)
+    {
+        replayed_count += replay.timings[type].count;
+    }
+
+    LOG_INFO("Replayed %llu events in %.2f ms.",
+        (unsigned long long)replayed_count, elapsed_time / 1000000.0);
+
+    // Log the table, with times in microseconds.
+    LOG_INFO("%-20s %10s %12s %10s %10s", "event", "count", "total (us)", "mean (us)", "max (us)");
+    for (int type = 0; type < EVENT_TRACE_TYPES; type++)
+    {
+        ReplayTiming *timing = &replay.timings[type];
+        if (timing->count == 0) continue;
+
+        // Name the event type after its event handlers, if it has any.
+        char type_name[32];
+        const char *handled_type_name = get_event_type_name(type);
+        if (handled_type_name != NULL)
+        {
+            snprintf(type_name, sizeof(type_name), "%s", handled_type_name);
+        }
+        else
+        {
+            snprintf(type_name, sizeof(type_name), "%d", type);
+        }
+
+        LOG_INFO("%-20s %10llu %12llu %10llu %10llu",
+            type_name,
+            (unsigned long long)timing->count,
+            (unsigned long long)(timing->total_time / 1000),
+            (unsigned long long)(timing->total_time / timing->count / 1000),
+            (unsigned long long)(timing->max_time / 1000));
+    }
+}
+
+void replay_traced_events(int max_count)
+{
+    if (replay.start_time == 0) replay.start_time = get_monotonic_time();
+
+    int replayed_count = 0;
+    while (replay.position < replay.record_count && replayed_count < max_count)
+    {
+        TraceRecord *record = &replay.records[replay.position];
+        replay.position++;
+
+        // Pointer positions are only used along with their event.
+        if (record->kind != TRACE_RECORD_EVENT) continue;
+
+        // Provide the pointer positions queried while the event was handled.
+        while (replay.position < replay.record_count &&
+               replay.records[replay.position].kind == TRACE_RECORD_POINTER)
+        {
+            TraceRecord *pointer_record = &replay.records[replay.position];
+            seed_pointer_position(pointer_record->x_root, pointer_record->y_root);
+            replay.position++;
+        }
+
+        // Prepare the event for this session.
+        Event event = record->event;
+        if (!prepare_replayed_event(&event)) continue;
+
+        // Handle the event, measuring how long it takes.
+        uint64_t start_time = get_monotonic_time();
+        call_event_handlers(&event);
+        uint64_t elapsed_time = get_monotonic_time() - start_time;
+
+        // Accumulate the measurement by event type.
+        if (event.type >= 0 && event.type < EVENT_TRACE_TYPES)
+        {
+            ReplayTiming *timing = &replay.timings[event.type];
+            timing->count++;
+            timing->total_time += elapsed_time;
+            if (elapsed_time > timing->max_time) timing->max_time = elapsed_time;
+        }
+        replayed_count++;
+    }
+
+    // Report and exit once the whole trace was replayed, waiting for the X
+    // server to finish all requests first.
+    if (replay.position >= replay.record_count)
+    {
+        XSync(DefaultDisplay, False);
+        log_replay_timings();
+        exit(EXIT_SUCCESS);
+    }
+}
+
+HANDLE(Initialize)
+{
+    // Never record while replaying.
+    if (is_replaying_event_trace()) return;
+
+    int event_trace;
+    GET_CONFIG(&event_trace, sizeof(event_trace), CFG_BUNDLE_EVENT_TRACE);
+    if (event_trace == 0) return;
+
+    // Allocate the ring buffer.
+    recorder.records = malloc(EVENT_TRACE_CAPACITY * sizeof(TraceRecord));
+    if (recorder.records == NULL)
+    {
+        LOG_ERROR("Could not enable event tracing, memory allocation failed.");
+    }
+}
+
+HANDLE(SignalReceived)
+{
+    SignalReceivedEvent *_event = &event->signal_received;
+
+    if (_event->signal_number != SIGUSR2) return;
+    if (recorder.records == NULL) return;
+
+    write_event_trace();
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Records an event dispatched by the event loop into the event trace, if
+ * tracing is enabled.
+ *
+ * @param event The event about to be handled.
+ *
+ * @note Events raised by event handlers are not recorded, as replaying the
+ * event which raised them raises them again.
+ */
+void record_traced_event(Event *event);
+
+/**
+ * Records a pointer position queried from the X server into the event trace,
+ * if tracing is enabled, so replays see the same pointer movement.
+ *
+ * @param x_root The X coordinate relative to root.
+ * @param y_root The Y coordinate relative to root.
+ */
+void record_traced_pointer_position(int x_root, int y_root);
+
+/**
+ * Loads an event trace to be replayed by the event loop instead of the events
+ * of the X server.
+ *
+ * @param path The path of the trace file.
+ *
+ * @return - `0` The trace was loaded.
+ * @return - `-1` The trace could not be read, or was recorded by an
+ * incompatible build.
+ */
+int load_event_trace(const char *path);
+
+/**
+ * Checks whether an event trace is being replayed.
+ *
+ * @return - `true` A trace is being replayed.
+ * @return - `false` Events come from the X server.
+ */
+bool is_replaying_event_trace();
+
+/**
+ * Checks whether an event received from the X server should be handled while
+ * a trace is being replayed.
+ *
+ * Only feedback about rendering, such as damage and frame presentation, is
+ * taken from the X server during a replay. Everything else comes from the
+ * trace.
+ *
+ * @param event The event received from the X server.
+ *
+ * @return - `true` The event should be handled.
+ * @return - `false` The event should be discarded.
+ */
+bool should_handle_live_event(Event *event);
+
+/**
+ * Replays the next events of the loaded trace, measuring how long handling
+ * each of them takes.
+ *
+ * @param max_count The maximum number of events to replay.
+ *
+ * @note Once the whole trace is replayed, the timings per event type are
+ * logged and the window manager exits.
+ */
+void replay_traced_events(int max_count);
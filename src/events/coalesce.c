@@ -0,0 +1,173 @@
+/**
+ * This code is responsible for coalescing events before they are dispatched.
+ *
+ * Handlers of the coalesced event types only act on the latest state, such as
+ * the current pointer position, window geometry or property value, so earlier
+ * events describing the same state can be dropped without changing the result.
+ * Everything else is dispatched as it was received, in the same order.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    int type;
+    Window event_window;
+    Window window;
+    unsigned long detail;
+    int event_index;
+} CoalesceKey;
+
+typedef struct {
+    CoalesceKey *keys;
+    int count;
+    int capacity;
+} CoalesceKeys;
+
+static CoalesceKeys seen_keys = {
+    .keys = NULL,
+    .count = 0,
+    .capacity = 0
+};
+
+static bool get_coalesce_key(Event *event, CoalesceKey *out_key)
+{
+    if (event->type == RawMotionNotify)
+    {
+        *out_key = (CoalesceKey){
+            .type = RawMotionNotify,
+            .event_window = None,
+            .window = None,
+            .detail = 0
+        };
+        return true;
+    }
+    else if (event->type == ConfigureNotify)
+    {
+        *out_key = (CoalesceKey){
+            .type = ConfigureNotify,
+            .event_window = event->xconfigure.event,
+            .window = event->xconfigure.window,
+            .detail = event->xconfigure.above
+        };
+        return true;
+    }
+    else if (event->type == PropertyNotify)
+    {
+        *out_key = (CoalesceKey){
+            .type = PropertyNotify,
+            .event_window = None,
+            .window = event->xproperty.window,
+            .detail = event->xproperty.atom
+        };
+        return true;
+    }
+    return false;
+}
+
+static int find_seen_key(CoalesceKey *key)
+{
+    for (int i = 0; i < seen_keys.count; i++)
+    {
+        CoalesceKey *seen_key = &seen_keys.keys[i];
+        if (seen_key->type == key->type &&
+            seen_key->event_window == key->event_window &&
+            seen_key->window == key->window &&
+            seen_key->detail == key->detail)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void forget_seen_key(int index)
+{
+    seen_keys.count--;
+    seen_keys.keys[index] = seen_keys.keys[seen_keys.count];
+}
+
+int coalesce_events(Event *events, int count)
+{
+    // Allocate enough keys for every event of the batch, if necessary.
+    if (count > seen_keys.capacity)
+    {
+        CoalesceKey *keys = realloc(seen_keys.keys, count * sizeof(CoalesceKey));
+        if (keys == NULL)
+        {
+            LOG_WARNING("Could not coalesce events, memory allocation failed.");
+            return count;
+        }
+        seen_keys.keys = keys;
+        seen_keys.capacity = count;
+    }
+    seen_keys.count = 0;
+
+    // Walk the batch backwards, so the latest event of each key is seen
+    // first, and mark the earlier ones as dropped.
+    for (int i = count - 1; i >= 0; i--)
+    {
+        Event *event = &events[i];
+
+        // Pointer button events depend on the motion before them, such as
+        // the final position of a drag, so motion can't be coalesced across.
+        if (event->type == RawButtonPress || event->type == RawButtonRelease)
+        {
+            CoalesceKey motion_key = { .type = RawMotionNotify };
+            int motion_index = find_seen_key(&motion_key);
+            if (motion_index != -1) forget_seen_key(motion_index);
+            continue;
+        }
+
+        // Skip events which are never coalesced.
+        CoalesceKey key;
+        if (!get_coalesce_key(event, &key)) continue;
+
+        // Stacking changes are reported relative to sibling windows, so the
+        // configure notifications of sibling windows can't be coalesced
+        // across each other.
+        if (key.type == ConfigureNotify)
+        {
+            for (int j = seen_keys.count - 1; j >= 0; j--)
+            {
+                CoalesceKey *seen_key = &seen_keys.keys[j];
+                if (seen_key->type == ConfigureNotify &&
+                    seen_key->event_window == key.event_window &&
+                    seen_key->window != key.window)
+                {
+                    forget_seen_key(j);
+                }
+            }
+        }
+
+        // Drop the event if a later event with the same key was seen. Dropped
+        // motion hands its timestamp to the later motion, so the latency of
+        // the earliest motion is measured.
+        int seen_index = find_seen_key(&key);
+        if (seen_index != -1)
+        {
+            if (event->type == RawMotionNotify)
+            {
+                Event *later_event = &events[seen_keys.keys[seen_index].event_index];
+                later_event->raw_motion_notify.dequeue_time = event->raw_motion_notify.dequeue_time;
+            }
+            event->type = 0;
+            continue;
+        }
+
+        key.event_index = i;
+        seen_keys.keys[seen_keys.count] = key;
+        seen_keys.count++;
+    }
+
+    // Move the remaining events together, keeping their order. Event type 0
+    // is never used by X events, so it marks the dropped ones.
+    int remaining_count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (events[i].type == 0) continue;
+        if (remaining_count != i) events[remaining_count] = events[i];
+        remaining_count++;
+    }
+
+    return remaining_count;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Removes the events superseded by later events of the same batch, while
+ * keeping the order of the remaining events.
+ *
+ * An event is superseded by a later event describing the same state:
+ * - `RawMotionNotify` by a later `RawMotionNotify`, unless a pointer button
+ *   event lies in between.
+ * - `ConfigureNotify` by a later `ConfigureNotify` of the same window,
+ *   reported to the same window, with the same sibling, unless a sibling
+ *   window was configured in between.
+ * - `PropertyNotify` by a later `PropertyNotify` of the same window and
+ *   property.
+ *
+ * @param events The batch of events, which is compacted in place.
+ * @param count The number of events in the batch.
+ *
+ * @return The number of events left in the batch.
+ */
+int coalesce_events(Event *events, int count);
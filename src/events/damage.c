@@ -0,0 +1,25 @@
+#include "../all.h"
+
+static PortalDamagedEvent construct_portal_damaged_event(XDamageNotifyEvent *damage_event)
+{
+    PortalDamagedEvent event = {
+        .type = PortalDamaged,
+        .window = damage_event->drawable,
+        .portal = NULL,
+        .x_portal = damage_event->area.x,
+        .y_portal = damage_event->area.y,
+        .width = damage_event->area.width,
+        .height = damage_event->area.height,
+    };
+    return event;
+}
+
+Event convert_damage_event(XDamageNotifyEvent *damage_event)
+{
+    return (Event)construct_portal_damaged_event(damage_event);
+}
+
+void resolve_damage_event(PortalDamagedEvent *damaged_event)
+{
+    damaged_event->portal = find_portal_by_window(damaged_event->window);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Converts XDamage event data to a standard event structure.
+ *
+ * @param damage_event The XDamage notify event.
+ *
+ * @return The converted standard event.
+ */
+Event convert_damage_event(XDamageNotifyEvent *damage_event);
+
+/**
+ * Resolves the portal of a converted XDamage event from its damaged window.
+ *
+ * @param damaged_event The converted XDamage event.
+ *
+ * @note Must be called right before the event is dispatched, so the portal
+ * can't have been destroyed in the meantime.
+ */
+void resolve_damage_event(PortalDamagedEvent *damaged_event);
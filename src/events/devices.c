@@ -0,0 +1,108 @@
+/**
+ * This code is responsible for the XInput2 device table.
+ *
+ * Every device ever seen is stored at the index of its device ID, so finding
+ * the type of the device behind an event is a single array access. The table
+ * is built once at startup, and kept up to date through hierarchy events,
+ * which carry the new state of every affected device.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    InputDevice *devices;
+    int capacity;
+} DeviceTable;
+
+static DeviceTable device_table = {
+    .devices = NULL,
+    .capacity = 0
+};
+
+static InputDevice *get_device_slot(int device_id)
+{
+    if (device_id < 0) return NULL;
+
+    // Grow the table to fit the device ID, if necessary.
+    if (device_id >= device_table.capacity)
+    {
+        int capacity = max(device_id + 1, device_table.capacity * 2);
+        InputDevice *new_devices = realloc(device_table.devices, capacity * sizeof(InputDevice));
+        if (new_devices == NULL)
+        {
+            LOG_ERROR("Could not store input device, memory allocation failed.");
+            return NULL;
+        }
+
+        // Mark the new slots as empty.
+        for (int i = device_table.capacity; i < capacity; i++)
+        {
+            new_devices[i] = (InputDevice){ .present = false, .use = 0, .attachment = 0 };
+        }
+
+        device_table.devices = new_devices;
+        device_table.capacity = capacity;
+    }
+
+    return &device_table.devices[device_id];
+}
+
+int initialize_device_table(Display *display)
+{
+    // Query all devices at once.
+    int device_count = 0;
+    XIDeviceInfo *devices = XIQueryDevice(display, XIAllDevices, &device_count);
+    if (devices == NULL) return -1;
+
+    // Store each device at the index of its ID.
+    for (int i = 0; i < device_count; i++)
+    {
+        InputDevice *device = get_device_slot(devices[i].deviceid);
+        if (device == NULL) continue;
+
+        *device = (InputDevice){
+            .present = true,
+            .use = devices[i].use,
+            .attachment = devices[i].attachment
+        };
+    }
+
+    XIFreeDeviceInfo(devices);
+    return 0;
+}
+
+void update_device_table(XIHierarchyEvent *hierarchy_event)
+{
+    for (int i = 0; i < hierarchy_event->num_info; i++)
+    {
+        XIHierarchyInfo *info = &hierarchy_event->info[i];
+
+        // Skip devices which weren't affected by the change.
+        if (info->flags == 0) continue;
+
+        InputDevice *device = get_device_slot(info->deviceid);
+        if (device == NULL) continue;
+
+        // Forget removed devices.
+        if (info->flags & (XIMasterRemoved | XISlaveRemoved))
+        {
+            device->present = false;
+            continue;
+        }
+
+        // Store the new state of the device.
+        *device = (InputDevice){
+            .present = true,
+            .use = info->use,
+            .attachment = info->attachment
+        };
+    }
+}
+
+const InputDevice *find_input_device(int device_id)
+{
+    if (device_id < 0 || device_id >= device_table.capacity) return NULL;
+
+    InputDevice *device = &device_table.devices[device_id];
+    return device->present ? device : NULL;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * An XInput2 device, as known from the device hierarchy.
+ */
+typedef struct {
+    bool present;
+    int use;
+    int attachment;
+} InputDevice;
+
+/**
+ * Builds the device table from the current XInput2 device hierarchy.
+ *
+ * @param display The X11 display.
+ *
+ * @return - `0` - Execution was successful.
+ * @return - `-1` - The device hierarchy could not be queried.
+ */
+int initialize_device_table(Display *display);
+
+/**
+ * Applies the changes described by an XInput2 hierarchy event to the device
+ * table, without querying the X server.
+ *
+ * @param hierarchy_event The XInput2 hierarchy event.
+ */
+void update_device_table(XIHierarchyEvent *hierarchy_event);
+
+/**
+ * Finds a device in the device table.
+ *
+ * @param device_id The ID of the XInput2 device.
+ *
+ * @return - `InputDevice*` The device was found.
+ * @return - `NULL` The device is not known.
+ *
+ * @note The device use is one of `XIMasterPointer`, `XIMasterKeyboard`,
+ * `XISlavePointer`, `XISlaveKeyboard` or `XIFloatingSlave`. The attachment
+ * is the paired master device for masters and attached slaves.
+ */
+const InputDevice *find_input_device(int device_id);
@@ -1,8 +1,34 @@
 #include "../all.h"
 
-static Time last_update_time = 0;
-static Time last_select_time = 0;
-static Time throttle_ms = 0;
+/** The maximum number of events read from the queue per loop iteration. */
+#define MAX_EVENTS_PER_ITERATION 256
+
+/** The maximum number of file descriptors watched by the event loop. */
+#define MAX_EVENT_SOURCES 8
+
+typedef void EventSourceCallback(int fd);
+
+typedef struct {
+    int fd;
+    EventSourceCallback *callback;
+} EventSource;
+
+static uint64_t last_update_time = 0;
+static uint64_t frame_interval = 0;
+static bool update_requested = false;
+static bool update_throttled = true;
+static uint64_t deferred_update_time = 0;
+
+static int epoll_fd = -1;
+static EventSource event_sources[MAX_EVENT_SOURCES];
+static int event_source_count = 0;
+
+static int frame_timer_fd = -1;
+static uint64_t frame_timer_deadline = 0;
+
+static int xi_opcode = -1;
+static int damage_event_base = -1;
+static int present_opcode = -1;
 
 static const long x_root_event_mask =
     StructureNotifyMask |
@@ -14,7 +40,249 @@ static const long xi_root_event_mask =
     XI_RawButtonReleaseMask |
     XI_RawMotionMask |
     XI_RawKeyPressMask |
-    XI_RawKeyReleaseMask;
+    XI_RawKeyReleaseMask |
+    XI_HierarchyChangedMask;
+
+static void watch_event_source(int fd, EventSourceCallback *callback)
+{
+    // Ensure there is room for another event source.
+    if (event_source_count >= MAX_EVENT_SOURCES)
+    {
+        LOG_ERROR("Could not watch file descriptor (%d), too many event sources.", fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // Store the event source, so it can be found again once it is ready.
+    EventSource *source = &event_sources[event_source_count];
+    *source = (EventSource){
+        .fd = fd,
+        .callback = callback
+    };
+
+    // Register the file descriptor with epoll.
+    struct epoll_event epoll_event = {
+        .events = EPOLLIN,
+        .data.ptr = source
+    };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &epoll_event) != 0)
+    {
+        LOG_ERROR("Could not watch file descriptor (%d): %s", fd, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    event_source_count++;
+}
+
+static void handle_display_ready(int fd)
+{
+    // Pending X events are read after all event sources were handled.
+    (void)fd;
+}
+
+static void handle_dbus_ready(int fd)
+{
+    (void)fd;
+    dispatch_theme_dbus();
+}
+
+static void handle_frame_timer_ready(int fd)
+{
+    // Acknowledge the expiration, which also disarms the one-shot timer.
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+    frame_timer_deadline = 0;
+}
+
+static void handle_signal_ready(int fd)
+{
+    // Handle every pending signal.
+    struct signalfd_siginfo signal_info;
+    while (read(fd, &signal_info, sizeof(signal_info)) == sizeof(signal_info))
+    {
+        if (signal_info.ssi_signo == SIGCHLD)
+        {
+            // Reap all terminated child processes, such as launched terminals.
+            while (waitpid(-1, NULL, WNOHANG) > 0);
+        }
+        else if (signal_info.ssi_signo == SIGTERM)
+        {
+            LOG_INFO("Received termination signal, exiting.");
+            exit(EXIT_SUCCESS);
+        }
+        else
+        {
+            // Call all event handlers of the SignalReceived event. It's
+            // passed as a whole event, so the event trace can record it.
+            call_event_handlers(&(Event){ .signal_received = {
+                .type = SignalReceived,
+                .signal_number = signal_info.ssi_signo
+            }});
+        }
+    }
+}
+
+static uint64_t get_update_deadline()
+{
+    // Throttle updates to the configured framerate, unless disabled.
+    uint64_t deadline = update_throttled ? last_update_time + frame_interval : 0;
+
+    // Wait for a deferred update, if it's due later.
+    if (deferred_update_time > deadline) deadline = deferred_update_time;
+
+    return deadline;
+}
+
+static void arm_frame_timer(uint64_t deadline)
+{
+    // Skip if the timer is already armed for the deadline.
+    if (deadline == frame_timer_deadline) return;
+
+    // Arm the timer for the absolute deadline, or disarm it for zero.
+    struct itimerspec timer_spec = {
+        .it_interval = { .tv_sec = 0, .tv_nsec = 0 },
+        .it_value = {
+            .tv_sec = deadline / 1000000000ULL,
+            .tv_nsec = deadline % 1000000000ULL
+        }
+    };
+    timerfd_settime(frame_timer_fd, TFD_TIMER_ABSTIME, &timer_spec, NULL);
+    frame_timer_deadline = deadline;
+}
+
+static void initialize_event_sources(Display *display)
+{
+    // Create the epoll instance all file descriptors are registered to.
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        LOG_ERROR("Could not create epoll instance: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // Create the frame timer, which runs on the monotonic clock so it's not
+    // affected by changes to the system time.
+    frame_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (frame_timer_fd < 0)
+    {
+        LOG_ERROR("Could not create frame timer: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // Receive the handled signals through a file descriptor, instead of
+    // interrupting whatever is running when they arrive.
+    sigset_t signal_mask;
+    sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGCHLD);
+    sigaddset(&signal_mask, SIGTERM);
+    sigaddset(&signal_mask, SIGUSR1);
+    sigaddset(&signal_mask, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &signal_mask, NULL);
+    int signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0)
+    {
+        LOG_ERROR("Could not create signal file descriptor: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // Watch the file descriptors.
+    watch_event_source(ConnectionNumber(display), handle_display_ready);
+    watch_event_source(frame_timer_fd, handle_frame_timer_ready);
+    watch_event_source(signal_fd, handle_signal_ready);
+
+    // Watch the D-Bus connection, if it was established.
+    int dbus_fd = get_theme_dbus_fd();
+    if (dbus_fd >= 0)
+    {
+        watch_event_source(dbus_fd, handle_dbus_ready);
+    }
+}
+
+static bool read_event(Display *display, Event *out_event)
+{
+    // Retrieve the next X event.
+    XEvent x_event;
+    XNextEvent(display, &x_event);
+
+    // Downcast the X event to a standard event. Converted extension
+    // events are stored separately, so they outlive their conversion.
+    Event *event = (Event*)&x_event;
+    Event converted_event;
+
+    // Check if the X event originated from the XInput2 extension, if it
+    // did, convert it to a more developer-friendly event type.
+    if (event->type == GenericEvent && event->xcookie.extension == xi_opcode)
+    {
+        // Extract the XInput2 event data.
+        XGenericEventCookie *cookie = &x_event.xcookie;
+        XGetEventData(display, cookie);
+
+        // Keep the device table up to date with the device hierarchy.
+        if (cookie->evtype == XI_HierarchyChanged)
+        {
+            update_device_table(cookie->data);
+            XFreeEventData(display, cookie);
+            return false;
+        }
+
+        // Ignore the event if it originated from a slave device.
+        XIRawEvent *xi_raw_event = cookie->data;
+        const InputDevice *device = find_input_device(xi_raw_event->deviceid);
+        if (device == NULL ||
+            (device->use != XIMasterPointer && device->use != XIMasterKeyboard))
+        {
+            XFreeEventData(display, cookie);
+            return false;
+        }
+
+        // Outdate the cached pointer position on pointer events.
+        if (device->use == XIMasterPointer)
+        {
+            expire_pointer_position(xi_raw_event->serial);
+        }
+
+        // Construct a new event from the XInput2 event data, timestamped
+        // for latency tracking.
+        converted_event = convert_raw_xinput_event(xi_raw_event, get_input_timestamp());
+        event = &converted_event;
+
+        // Cleanup the original cookie data.
+        XFreeEventData(display, cookie);
+    }
+
+    // Check if the X event originated from the Present extension, if it
+    // did, convert it to a more developer-friendly event type.
+    if (event->type == GenericEvent && event->xcookie.extension == present_opcode)
+    {
+        // Extract the Present event data.
+        XGenericEventCookie *cookie = &x_event.xcookie;
+        XGetEventData(display, cookie);
+
+        // Ignore all Present events but completion notifications.
+        if (cookie->evtype != PresentCompleteNotify)
+        {
+            XFreeEventData(display, cookie);
+            return false;
+        }
+
+        // Construct a new event from the Present event data.
+        converted_event = convert_present_event(cookie->data);
+        event = &converted_event;
+
+        // Cleanup the original cookie data.
+        XFreeEventData(display, cookie);
+    }
+
+    // Check if the X event originated from the XDamage extension, if it
+    // did, convert it to a portal-level event type.
+    if (damage_event_base >= 0 && event->type == damage_event_base + XDamageNotify)
+    {
+        converted_event = convert_damage_event((XDamageNotifyEvent*)&x_event);
+        event = &converted_event;
+    }
+
+    // Store the event, as the X event only lives until the next one is read.
+    *out_event = *event;
+    return true;
+}
 
 void initialize_event_loop()
 {
@@ -22,17 +290,36 @@ void initialize_event_loop()
     Window root_window = DefaultRootWindow(display);
 
     // Retrieve the XInput2 extension opcode.
-    int xi_opcode;
     if (!XQueryExtension(display, "XInputExtension", &xi_opcode, &(int){0}, &(int){0}))
     {
         LOG_ERROR("Could not retrieve opcode of XInput2 extension.");
         exit(EXIT_FAILURE);
     }
 
+    // Retrieve the XDamage extension event base, if the extension is present.
+    if (!XDamageQueryExtension(display, &damage_event_base, &(int){0}))
+    {
+        damage_event_base = -1;
+    }
+
+    // Retrieve the Present extension opcode, if the extension is present.
+    if (!XPresentQueryExtension(display, &present_opcode, &(int){0}, &(int){0}))
+    {
+        present_opcode = -1;
+    }
+
     // Select which events we should listen for on the root window.
     XSelectInput(display, root_window, x_root_event_mask);
     xi_select_input(display, root_window, xi_root_event_mask);
 
+    // Build the device table after selecting hierarchy events, so no change
+    // to the hierarchy can be missed.
+    if (initialize_device_table(display) != 0)
+    {
+        LOG_ERROR("Could not query XInput2 devices.");
+        exit(EXIT_FAILURE);
+    }
+
     // Call all event handlers of the Prepare event.
     call_event_handlers((Event*)&(PrepareEvent){
         .type = Prepare
@@ -43,98 +330,90 @@ void initialize_event_loop()
         .type = Initialize
     });
 
+    // Start watching the file descriptors the event loop waits on.
+    initialize_event_sources(display);
+
     while (true)
     {
-        // Calculate timeout to enforce minimum spacing between iterations.
-        Time current_time = x_get_current_time();
-        Time since_last_select = current_time - last_select_time;
-        Time remaining_time = (since_last_select < throttle_ms)
-            ? (throttle_ms - since_last_select)
-            : 0;
-        struct timeval timeout = {
-            .tv_sec = 0,
-            .tv_usec = remaining_time * 1000
-        };
-
-        // Block until an X event or D-Bus message is received, or timeout.
-        fd_set read_fd_set;
-        FD_ZERO(&read_fd_set);
-        int display_fd = ConnectionNumber(display);
-        int dbus_fd = get_theme_dbus_fd();
-        int highest_fd = display_fd;
-        FD_SET(display_fd, &read_fd_set);
-        if (dbus_fd >= 0)
+        // Determine whether the next update is already due. Otherwise, the
+        // frame timer wakes us up once it is.
+        bool update_due = false;
+        if (update_requested)
+        {
+            uint64_t deadline = get_update_deadline();
+            update_due = get_monotonic_time() >= deadline;
+            arm_frame_timer(update_due ? 0 : deadline);
+        }
+        else
         {
-            FD_SET(dbus_fd, &read_fd_set);
-            if (dbus_fd > highest_fd) highest_fd = dbus_fd;
+            arm_frame_timer(0);
         }
-        select(highest_fd + 1, &read_fd_set, NULL, NULL, &timeout);
 
-        // Record when we woke up to enforce spacing on next iteration.
-        last_select_time = x_get_current_time();
+        // Block until a watched file descriptor is ready, unless events were
+        // already read from the connection, as they won't wake us up, or a
+        // trace is being replayed.
+        bool replaying = is_replaying_event_trace();
+        int timeout = (update_due || XQLength(display) > 0 || replaying) ? 0 : -1;
+        struct epoll_event ready_events[MAX_EVENT_SOURCES];
+        int ready_count = epoll_wait(epoll_fd, ready_events, MAX_EVENT_SOURCES, timeout);
 
-        // Dispatch D-Bus messages if available.
-        if (dbus_fd >= 0 && FD_ISSET(dbus_fd, &read_fd_set))
+        // Handle the ready file descriptors.
+        for (int i = 0; i < ready_count; i++)
         {
-            dispatch_theme_dbus();
+            EventSource *source = ready_events[i].data.ptr;
+            source->callback(source->fd);
         }
 
-        // Process pending X events in batches. Without a limit, a flood of
+        // Read pending X events in batches. Without a limit, a flood of
         // events (e.g., rapid mouse movement) could starve the Update event,
         // preventing compositor redraws and freezing the UI.
-        int events_processed = 0;
-        const int max_events_per_iteration = 50;
-        while (XPending(display) > 0 && events_processed < max_events_per_iteration)
+        static Event events[MAX_EVENTS_PER_ITERATION];
+        int event_count = 0;
+        while (XPending(display) > 0 && event_count < MAX_EVENTS_PER_ITERATION)
         {
-            events_processed++;
-
-            // Retrieve the next X event.
-            XEvent x_event;
-            XNextEvent(display, &x_event);
-
-            // Downcast the X event to a standard event.
-            Event *event = (Event*)&x_event;
-
-            // Check if the X event originated from the XInput2 extension, if it
-            // did, convert it to a more developer-friendly event type.
-            if (event->type == GenericEvent && event->xcookie.extension == xi_opcode)
+            if (read_event(display, &events[event_count]) &&
+                should_handle_live_event(&events[event_count]))
             {
-                // Extract the XInput2 event data.
-                XGenericEventCookie *cookie = &x_event.xcookie;
-                XGetEventData(display, cookie);
-                XIRawEvent *xi_raw_event = cookie->data;
-
-                // Ignore the event if it originated from a slave device.
-                int device_type = 0;
-                xi_get_device_type(display, xi_raw_event->deviceid, &device_type);
-                if (device_type != XIMasterPointer && device_type != XIMasterKeyboard)
-                {
-                    XFreeEventData(display, cookie);
-                    continue;
-                }
-
-                // Construct a new event from the XInput2 event data.
-                Event new_event = convert_raw_xinput_event(xi_raw_event);
-                event = &new_event;
-
-                // Cleanup the original cookie data.
-                XFreeEventData(display, cookie);
+                event_count++;
             }
+        }
 
-            // Call the appropriate event handlers.
-            call_event_handlers(event);
+        // Drop the events superseded by later events of the batch.
+        event_count = coalesce_events(events, event_count);
+
+        // Call the appropriate event handlers, in the order of the events.
+        // Damaged portals are only looked up now, as handling earlier events
+        // of the batch may have destroyed them.
+        for (int i = 0; i < event_count; i++)
+        {
+            if (events[i].type == PortalDamaged) resolve_damage_event(&events[i].portal_damaged);
+            call_event_handlers(&events[i]);
+        }
+
+        // Replay the next batch of the event trace, which brings its own
+        // Update events.
+        if (replaying)
+        {
+            replay_traced_events(MAX_EVENTS_PER_ITERATION);
+            continue;
         }
 
         // Get fresh time after processing events for accurate Update timing.
-        Time update_check_time = x_get_current_time();
+        uint64_t update_check_time = get_monotonic_time();
 
-        // Check if sufficient time has passed since the last update.
-        if (update_check_time - last_update_time >= throttle_ms)
+        // Check if an update was requested and sufficient time has passed
+        // since the last update.
+        if (update_requested && update_check_time >= get_update_deadline())
         {
-            // Call all event handlers of the Update event.
-            call_event_handlers((Event*)&(UpdateEvent){
+            // Clear the request first, so handlers can request another update.
+            update_requested = false;
+            deferred_update_time = 0;
+
+            // Call all event handlers of the Update event. It's passed as a
+            // whole event, so the event trace can record it.
+            call_event_handlers(&(Event){ .update = {
                 .type = Update
-            });
+            }});
 
             // Update the last update time.
             last_update_time = update_check_time;
@@ -142,12 +421,42 @@ void initialize_event_loop()
     }
 }
 
+void request_update()
+{
+    // An immediate request overrides a deferred one.
+    update_requested = true;
+    deferred_update_time = 0;
+
+    // Attribute the update to the input event being handled, if any.
+    attribute_frame_to_input();
+}
+
+void request_deferred_update(uint64_t delay)
+{
+    // Keep an earlier request, whether immediate or deferred.
+    uint64_t deadline = get_monotonic_time() + delay;
+    if (update_requested && deferred_update_time <= deadline) return;
+
+    update_requested = true;
+    deferred_update_time = deadline;
+}
+
+uint64_t get_frame_interval()
+{
+    return frame_interval;
+}
+
+void disable_update_throttle()
+{
+    update_throttled = false;
+}
+
 HANDLE(Initialize)
 {
     // Get the framerate from the configuration.
     int framerate;
     GET_CONFIG(&framerate, sizeof(framerate), CFG_BUNDLE_FRAMERATE);
 
-    // Convert the framerate to a throttle time and store it.
-    throttle_ms = (Time)framerate_to_throttle_ms(framerate);
+    // Convert the framerate to a frame interval in nanoseconds and store it.
+    frame_interval = (framerate > 0) ? 1000000000ULL / framerate : 1000000ULL;
 }
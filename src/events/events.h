@@ -151,6 +151,7 @@ typedef struct {
 typedef struct {
     int type;
     int button;
+    uint64_t dequeue_time;
 } RawButtonPressEvent;
 
 /**
@@ -164,6 +165,7 @@ typedef struct {
 typedef struct {
     int type;
     int button;
+    uint64_t dequeue_time;
 } RawButtonReleaseEvent;
 
 /**
@@ -176,6 +178,7 @@ typedef struct {
 #define RawMotionNotify 144
 typedef struct {
     int type;
+    uint64_t dequeue_time;
 } RawMotionNotifyEvent;
 
 /**
@@ -189,6 +192,7 @@ typedef struct {
 typedef struct {
     int type;
     int key_code;
+    uint64_t dequeue_time;
 } RawKeyPressEvent;
 
 /**
@@ -202,6 +206,7 @@ typedef struct {
 typedef struct {
     int type;
     int key_code;
+    uint64_t dequeue_time;
 } RawKeyReleaseEvent;
 
 /**
@@ -221,6 +226,50 @@ typedef struct {
     int type;
 } ThemeChangedEvent;
 
+/**
+ * An event triggered when the contents of a portal change, provided by the
+ * XDamage extension.
+ *
+ * The damaged area is the bounding box of all changes since the damage was
+ * last acknowledged, relative to the portal. The portal is only resolved from
+ * the damaged window once the event is dispatched, as earlier events of the
+ * same batch may destroy it.
+ */
+#define PortalDamaged 149
+typedef struct {
+    int type;
+    Window window;
+    Portal *portal;
+    int x_portal; int y_portal;
+    unsigned int width; unsigned int height;
+} PortalDamagedEvent;
+
+/**
+ * An event triggered when a frame presented to the root window has been
+ * displayed, provided by the Present extension.
+ *
+ * The serial matches the serial the frame was presented with, while the MSC
+ * (media stream counter) and UST (unadjusted system time, in microseconds)
+ * describe when the frame was displayed.
+ */
+#define FramePresented 150
+typedef struct {
+    int type;
+    uint32_t serial;
+    uint64_t msc;
+    uint64_t ust;
+} FramePresentedEvent;
+
+/**
+ * An event triggered when the window manager receives a user signal, such as
+ * `SIGUSR1`, through the event loop.
+ */
+#define SignalReceived 151
+typedef struct {
+    int type;
+    int signal_number;
+} SignalReceivedEvent;
+
 /**
  * A union of all possible event types that can be handled by the window
  * manager.
@@ -239,6 +288,8 @@ typedef union {
 
     // System events.
     ThemeChangedEvent theme_changed;
+    FramePresentedEvent frame_presented;
+    SignalReceivedEvent signal_received;
 
     // Portal events.
     PortalCreatedEvent portal_created;
@@ -252,6 +303,7 @@ typedef union {
     PortalButtonReleaseEvent portal_button_release;
     PortalMotionNotifyEvent portal_motion_notify;
     PortalFocusedEvent portal_focused;
+    PortalDamagedEvent portal_damaged;
 
     // Shortcut events.
     ShortcutPressedEvent shortcut_pressed;
@@ -304,3 +356,39 @@ typedef union {
  * in, and calling the appropriate registered event handlers.
  */
 void initialize_event_loop();
+
+/**
+ * Requests an Update event from the event loop.
+ *
+ * The event loop sleeps indefinitely while no update is requested, and calls
+ * the Update event handlers no sooner than the configured framerate allows.
+ *
+ * @note Multiple requests made before the next Update event are combined.
+ */
+void request_update();
+
+/**
+ * Requests an Update event from the event loop, no sooner than after the
+ * given delay.
+ *
+ * @param delay The delay in nanoseconds.
+ *
+ * @note An earlier request, whether immediate or deferred, is kept as it is.
+ */
+void request_deferred_update(uint64_t delay);
+
+/**
+ * Retrieves the interval between Update events at the configured framerate.
+ *
+ * @return The frame interval in nanoseconds.
+ */
+uint64_t get_frame_interval();
+
+/**
+ * Stops the event loop from throttling Update events to the configured
+ * framerate.
+ *
+ * @note Intended for when redraws are already paced by the display, such as
+ * through the Present extension.
+ */
+void disable_update_throttle();
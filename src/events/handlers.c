@@ -1,56 +1,238 @@
+/**
+ * This code is responsible for the event handler registry.
+ *
+ * Event handlers are grouped by event type as they are registered, in a table
+ * indexed by the event type itself. Calling the event handlers of an event
+ * then only visits the handlers registered for its type, in the order they
+ * were registered.
+ *
+ * Each event handler also records where it was defined, so that it can be
+ * told apart when profiling, which measures every call of an event handler
+ * once enabled.
+ */
+
 #include "../all.h"
 
 typedef struct {
-    int type;
-    EventCallback *callback;
-} EventHandler;
+    EventHandlerSource source;
+    uint64_t call_count;
+    uint64_t total_time;
+    uint64_t max_time;
+} EventHandlerProfile;
 
 typedef struct {
-    EventHandler *handlers;
+    EventCallback **callbacks;
+    EventHandlerProfile *profiles;
     int count;
     int capacity;
 } EventHandlers;
 
-static EventHandlers event_handlers = {
-    .handlers = NULL,
-    .count = 0,
-    .capacity = 0,
+typedef struct {
+    EventHandlers *types;
+    int type_count;
+} EventHandlerTable;
+
+static EventHandlerTable event_handler_table = {
+    .types = NULL,
+    .type_count = 0,
 };
 
-void register_event_handler(int type, EventCallback *callback)
+static bool profiling_enabled = false;
+
+static int dispatch_depth = 0;
+
+static EventHandlers *get_event_handlers(int type)
 {
+    // Grow the table to fit the event type, if necessary.
+    if (type >= event_handler_table.type_count)
+    {
+        int type_count = type + 1;
+        EventHandlers *types = realloc(event_handler_table.types, type_count * sizeof(EventHandlers));
+        if (types == NULL)
+        {
+            LOG_ERROR("Failed to allocate memory for event handlers.");
+            exit(EXIT_FAILURE);
+        }
+
+        // Start the new event types without any event handlers.
+        for (int i = event_handler_table.type_count; i < type_count; i++)
+        {
+            types[i] = (EventHandlers){
+                .callbacks = NULL,
+                .profiles = NULL,
+                .count = 0,
+                .capacity = 0,
+            };
+        }
+
+        event_handler_table.types = types;
+        event_handler_table.type_count = type_count;
+    }
+
+    return &event_handler_table.types[type];
+}
+
+void register_event_handler(int type, EventCallback *callback, EventHandlerSource *source)
+{
+    // Ensure the event type can be used as an index.
+    if (type < 0)
+    {
+        LOG_ERROR("Could not register event handler, invalid event type (%d).", type);
+        return;
+    }
+
+    // Get the event handlers of the event type.
+    EventHandlers *event_handlers = get_event_handlers(type);
+
     // Increase the event handlers count.
-    event_handlers.count++;
+    event_handlers->count++;
 
     // Allocate additional memory for the event handlers if necessary.
-    if (event_handlers.count > event_handlers.capacity)
+    if (event_handlers->count > event_handlers->capacity)
     {
-        event_handlers.capacity = event_handlers.capacity == 0 ? 2 : event_handlers.capacity * 2;
-        EventHandler *handlers = realloc(event_handlers.handlers, event_handlers.capacity * sizeof(EventHandler));
-        if (handlers == NULL)
+        event_handlers->capacity = event_handlers->capacity == 0 ? 2 : event_handlers->capacity * 2;
+        EventCallback **callbacks = realloc(event_handlers->callbacks, event_handlers->capacity * sizeof(EventCallback *));
+        if (callbacks == NULL)
+        {
+            LOG_ERROR("Failed to allocate memory for event handlers.");
+            exit(EXIT_FAILURE);
+        }
+        event_handlers->callbacks = callbacks;
+
+        EventHandlerProfile *profiles = realloc(event_handlers->profiles, event_handlers->capacity * sizeof(EventHandlerProfile));
+        if (profiles == NULL)
         {
             LOG_ERROR("Failed to allocate memory for event handlers.");
             exit(EXIT_FAILURE);
         }
-        event_handlers.handlers = handlers;
+        event_handlers->profiles = profiles;
     }
 
-    // Register the event handler.
-    event_handlers.handlers[event_handlers.count - 1] = (EventHandler){
-        .type = type,
-        .callback = callback,
+    // Register the event handler, along with where it was defined.
+    event_handlers->callbacks[event_handlers->count - 1] = callback;
+    event_handlers->profiles[event_handlers->count - 1] = (EventHandlerProfile){
+        .source = *source,
+        .call_count = 0,
+        .total_time = 0,
+        .max_time = 0,
     };
 }
 
 void call_event_handlers(Event *event)
 {
-    // Iterate through all event handlers, calling the callback of each event
-    // handler that has a matching event type.
-    for (int i = 0; i < event_handlers.count; i++)
+    // Ensure event handlers were registered for the event type.
+    int type = event->type;
+    if (type < 0 || type >= event_handler_table.type_count) return;
+
+    // Record events dispatched by the event loop, but not the events raised
+    // while handling them.
+    if (dispatch_depth == 0) record_traced_event(event);
+    dispatch_depth++;
+
+    // Attribute everything the event handlers request to the event, if it's
+    // an input event, so its latency can be measured.
+    InputAttribution previous_attribution = begin_input_attribution(event);
+
+    // Call the callback of each event handler of the event type.
+    EventHandlers *event_handlers = &event_handler_table.types[type];
+    if (!profiling_enabled)
     {
-        if (event_handlers.handlers[i].type == event->type)
+        for (int i = 0; i < event_handlers->count; i++)
         {
-            event_handlers.handlers[i].callback(event);
+            event_handlers->callbacks[i](event);
         }
     }
+    else
+    {
+        for (int i = 0; i < event_handlers->count; i++)
+        {
+            // Measure the call of the event handler.
+            uint64_t start_time = get_monotonic_time();
+            event_handlers->callbacks[i](event);
+            uint64_t elapsed_time = get_monotonic_time() - start_time;
+
+            // Accumulate the measurement.
+            EventHandlerProfile *profile = &event_handlers->profiles[i];
+            profile->call_count++;
+            profile->total_time += elapsed_time;
+            if (elapsed_time > profile->max_time) profile->max_time = elapsed_time;
+        }
+    }
+
+    end_input_attribution(previous_attribution);
+    dispatch_depth--;
+}
+
+const char *get_event_type_name(int type)
+{
+    if (type < 0 || type >= event_handler_table.type_count) return NULL;
+
+    // Take the name from the first event handler of the event type.
+    EventHandlers *event_handlers = &event_handler_table.types[type];
+    if (event_handlers->count == 0) return NULL;
+
+    return event_handlers->profiles[0].source.type_name;
+}
+
+void enable_event_handler_profiling()
+{
+    profiling_enabled = true;
+}
+
+static int compare_profiles_by_total_time(const void *a, const void *b)
+{
+    const EventHandlerProfile *profile_a = *(const EventHandlerProfile **)a;
+    const EventHandlerProfile *profile_b = *(const EventHandlerProfile **)b;
+    if (profile_a->total_time == profile_b->total_time) return 0;
+    return profile_a->total_time < profile_b->total_time ? 1 : -1;
+}
+
+void log_event_handler_profile()
+{
+    // Count the event handlers across all event types.
+    int handler_count = 0;
+    for (int type = 0; type < event_handler_table.type_count; type++)
+    {
+        handler_count += event_handler_table.types[type].count;
+    }
+
+    // Collect the profiles of the called event handlers.
+    EventHandlerProfile **profiles = malloc(handler_count * sizeof(EventHandlerProfile *));
+    if (profiles == NULL)
+    {
+        LOG_ERROR("Could not log event handler profile, memory allocation failed.");
+        return;
+    }
+    int profile_count = 0;
+    for (int type = 0; type < event_handler_table.type_count; type++)
+    {
+        EventHandlers *event_handlers = &event_handler_table.types[type];
+        for (int i = 0; i < event_handlers->count; i++)
+        {
+            if (event_handlers->profiles[i].call_count == 0) continue;
+            profiles[profile_count] = &event_handlers->profiles[i];
+            profile_count++;
+        }
+    }
+
+    // Order the event handlers by their total time, most expensive first.
+    qsort(profiles, profile_count, sizeof(EventHandlerProfile *), compare_profiles_by_total_time);
+
+    // Log the table, with times in microseconds.
+    LOG_INFO("%12s %10s %10s %10s  %-20s %s",
+        "total (us)", "calls", "mean (us)", "max (us)", "event", "handler");
+    for (int i = 0; i < profile_count; i++)
+    {
+        EventHandlerProfile *profile = profiles[i];
+        LOG_INFO("%12llu %10llu %10llu %10llu  %-20s %s:%d",
+            (unsigned long long)(profile->total_time / 1000),
+            (unsigned long long)profile->call_count,
+            (unsigned long long)(profile->total_time / profile->call_count / 1000),
+            (unsigned long long)(profile->max_time / 1000),
+            profile->source.type_name,
+            profile->source.file,
+            profile->source.line);
+    }
+
+    free(profiles);
 }
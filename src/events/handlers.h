@@ -9,20 +9,26 @@
  * event handler callback function.
  * 
  * It then defines the implementations of these two functions: the registration 
- * function registers the event handler, and the event handler callback function
- * is left empty, to be filled in by the user.
+ * function registers the event handler along with where it was defined, and
+ * the event handler callback function is left empty, to be filled in by the
+ * user.
  * 
  * @param type The event type.
+ * @param type_string The name of the event type.
  * @param count The counter value.
  * 
  * @warning Don't use directly! Use the `HANDLE()` macro instead.
  */
-#define HANDLE_IMPLEMENTATION(type, count) \
+#define HANDLE_IMPLEMENTATION(type, type_string, count) \
     static void register_handler_##type##_##count() __attribute__((constructor)); \
     static void handler_##type##_##count(__attribute__((unused)) Event *event); \
     static void register_handler_##type##_##count() \
     { \
-        register_event_handler(type, &handler_##type##_##count); \
+        register_event_handler(type, &handler_##type##_##count, &(EventHandlerSource){ \
+            .type_name = type_string, \
+            .file = __FILE__, \
+            .line = __LINE__ \
+        }); \
     } \
     static void handler_##type##_##count(__attribute__((unused)) Event *event)
 
@@ -33,11 +39,12 @@
  * It adds the `count` parameter, used to prevent naming collisions.
  * 
  * @param type The event type.
+ * @param type_string The name of the event type.
  * @param count The counter value.
  * 
  * @warning Don't use directly! Use the `HANDLE()` macro instead.
  */
-#define HANDLE_EXPANDED(type, count) HANDLE_IMPLEMENTATION(type, count)
+#define HANDLE_EXPANDED(type, type_string, count) HANDLE_IMPLEMENTATION(type, type_string, count)
 
 /**
  * A macro that simplifies the process of creating and registering event
@@ -45,7 +52,16 @@
  * 
  * @param type The event type.
  */
-#define HANDLE(type) HANDLE_EXPANDED(type, __COUNTER__)
+#define HANDLE(type) HANDLE_EXPANDED(type, #type, __COUNTER__)
+
+/**
+ * Describes where an event handler was defined.
+ */
+typedef struct {
+    const char *type_name;
+    const char *file;
+    int line;
+} EventHandlerSource;
 
 /**
  * Event handler callback function signature.
@@ -59,10 +75,11 @@ typedef void EventCallback(Event *event);
  * 
  * @param type The event type.
  * @param callback The event handler callback function.
+ * @param source Where the event handler was defined.
  * 
  * @warning Don't use directly! Use the `HANDLE()` macro instead.
  */
-void register_event_handler(int type, EventCallback *callback);
+void register_event_handler(int type, EventCallback *callback, EventHandlerSource *source);
 
 /**
  * Calls all registered event handler callback functions for a given event type.
@@ -71,3 +88,28 @@ void register_event_handler(int type, EventCallback *callback);
  * which event handlers to call.
  */
 void call_event_handlers(Event *event);
+
+/**
+ * Retrieves the name of an event type, as written by its event handlers.
+ *
+ * @param type The event type.
+ *
+ * @return - `const char*` The name of the event type.
+ * @return - `NULL` No event handlers were registered for the event type.
+ */
+const char *get_event_type_name(int type);
+
+/**
+ * Starts measuring the call count, total time and worst-case time of every
+ * event handler.
+ *
+ * @note Time spent in nested event handlers is included in the time of the
+ * event handler calling them.
+ */
+void enable_event_handler_profiling();
+
+/**
+ * Logs the measurements of all called event handlers in a table, ordered by
+ * their total time.
+ */
+void log_event_handler_profile();
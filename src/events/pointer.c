@@ -0,0 +1,75 @@
+/**
+ * This code is responsible for the pointer position cache.
+ *
+ * Raw XInput2 events don't carry the pointer position, so it has to be queried
+ * from the X server. All events generated before a query are read from the
+ * connection before its reply, so the queried position is never older than
+ * them. Only events carrying the serial of the query or a later one can be
+ * newer, which is what makes the cached position outdated.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    int x_root, y_root;
+    unsigned long query_serial;
+    bool outdated;
+} PointerState;
+
+static PointerState pointer_state = {
+    .x_root = 0,
+    .y_root = 0,
+    .query_serial = 0,
+    .outdated = true
+};
+
+void get_pointer_position(int *out_x_root, int *out_y_root)
+{
+    // Query the pointer position, only if it may have changed.
+    if (pointer_state.outdated)
+    {
+        Display *display = DefaultDisplay;
+        Window root_window = DefaultRootWindow(display);
+
+        // Remember the request, so newer pointer events can be told apart.
+        pointer_state.query_serial = NextRequest(display);
+        XQueryPointer(
+            display,                // Display
+            root_window,            // Window
+            &(Window){0},           // Root (Unused)
+            &(Window){0},           // Child (Unused)
+            &pointer_state.x_root,  // Pointer X (Relative to root)
+            &pointer_state.y_root,  // Pointer Y (Relative to root)
+            &(int){0},              // Window X (Unused)
+            &(int){0},              // Window Y (Unused)
+            &(unsigned int){0}      // Mask (Unused)
+        );
+        pointer_state.outdated = false;
+
+        // Record the position, so replays of the event trace see it too.
+        record_traced_pointer_position(pointer_state.x_root, pointer_state.y_root);
+    }
+
+    *out_x_root = pointer_state.x_root;
+    *out_y_root = pointer_state.y_root;
+}
+
+void expire_pointer_position(unsigned long serial)
+{
+    // Events generated before the last query are already accounted for.
+    if (serial < pointer_state.query_serial) return;
+
+    pointer_state.outdated = true;
+}
+
+void seed_pointer_position(int x_root, int y_root)
+{
+    // Keep the position until the next seed, as the serials of replayed
+    // events don't relate to it.
+    pointer_state = (PointerState){
+        .x_root = x_root,
+        .y_root = y_root,
+        .query_serial = ULONG_MAX,
+        .outdated = false
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Retrieves the current pointer position, shared by all pointer event
+ * handlers.
+ *
+ * The position is only queried from the X server when pointer events arrived
+ * since the last query, so a batch of events costs a single round trip.
+ *
+ * @param out_x_root The output parameter to store the X coordinate relative
+ * to root.
+ * @param out_y_root The output parameter to store the Y coordinate relative
+ * to root.
+ */
+void get_pointer_position(int *out_x_root, int *out_y_root);
+
+/**
+ * Marks the cached pointer position as outdated, if the pointer event with the
+ * given serial was generated after the position was last queried.
+ *
+ * @param serial The serial of the pointer event.
+ */
+void expire_pointer_position(unsigned long serial);
+
+/**
+ * Replaces the cached pointer position with one recorded in an event trace,
+ * so handlers of replayed events see the pointer where it was when recorded.
+ *
+ * @param x_root The X coordinate relative to root.
+ * @param y_root The Y coordinate relative to root.
+ *
+ * @note Only used while replaying, as the position is never queried again
+ * until the next seed.
+ */
+void seed_pointer_position(int x_root, int y_root);
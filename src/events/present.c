@@ -0,0 +1,17 @@
+#include "../all.h"
+
+static FramePresentedEvent construct_frame_presented_event(XPresentCompleteNotifyEvent *complete_event)
+{
+    FramePresentedEvent event = {
+        .type = FramePresented,
+        .serial = complete_event->serial_number,
+        .msc = complete_event->msc,
+        .ust = complete_event->ust,
+    };
+    return event;
+}
+
+Event convert_present_event(XPresentCompleteNotifyEvent *complete_event)
+{
+    return (Event)construct_frame_presented_event(complete_event);
+}
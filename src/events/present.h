@@ -0,0 +1,11 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Converts Present extension event data to a standard event structure.
+ *
+ * @param complete_event The Present complete notify event.
+ *
+ * @return The converted standard event.
+ */
+Event convert_present_event(XPresentCompleteNotifyEvent *complete_event);
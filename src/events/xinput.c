@@ -1,71 +1,76 @@
 #include "../all.h"
 
-static RawButtonPressEvent construct_raw_button_press_event(XIRawEvent *raw_event)
+static RawButtonPressEvent construct_raw_button_press_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     RawButtonPressEvent event = {
         .type = RawButtonPress,
         .button = raw_event->detail,
+        .dequeue_time = dequeue_time,
     };
     return event;
 }
 
-static RawButtonReleaseEvent construct_raw_button_release_event(XIRawEvent *raw_event)
+static RawButtonReleaseEvent construct_raw_button_release_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     RawButtonReleaseEvent event = {
         .type = RawButtonRelease,
         .button = raw_event->detail,
+        .dequeue_time = dequeue_time,
     };
     return event;
 }
 
-static RawMotionNotifyEvent construct_raw_motion_notify_event(XIRawEvent *raw_event)
+static RawMotionNotifyEvent construct_raw_motion_notify_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     (void)raw_event;
     RawMotionNotifyEvent event = {
         .type = RawMotionNotify,
+        .dequeue_time = dequeue_time,
     };
     return event;
 }
 
-static RawKeyPressEvent construct_raw_key_press_event(XIRawEvent *raw_event)
+static RawKeyPressEvent construct_raw_key_press_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     RawKeyPressEvent event = {
         .type = RawKeyPress,
         .key_code = raw_event->detail,
+        .dequeue_time = dequeue_time,
     };
     return event;
 }
 
-static RawKeyReleaseEvent construct_raw_key_release_event(XIRawEvent *raw_event)
+static RawKeyReleaseEvent construct_raw_key_release_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     RawKeyReleaseEvent event = {
         .type = RawKeyRelease,
         .key_code = raw_event->detail,
+        .dequeue_time = dequeue_time,
     };
     return event;
 }
 
-Event convert_raw_xinput_event(XIRawEvent *raw_event)
+Event convert_raw_xinput_event(XIRawEvent *raw_event, uint64_t dequeue_time)
 {
     if (raw_event->evtype == XI_RawButtonPress)
     {
-        return (Event)construct_raw_button_press_event(raw_event);
+        return (Event)construct_raw_button_press_event(raw_event, dequeue_time);
     }
     else if (raw_event->evtype == XI_RawButtonRelease)
     {
-        return (Event)construct_raw_button_release_event(raw_event);
+        return (Event)construct_raw_button_release_event(raw_event, dequeue_time);
     }
     else if (raw_event->evtype == XI_RawMotion)
     {
-        return (Event)construct_raw_motion_notify_event(raw_event);
+        return (Event)construct_raw_motion_notify_event(raw_event, dequeue_time);
     }
     else if (raw_event->evtype == XI_RawKeyPress)
     {
-        return (Event)construct_raw_key_press_event(raw_event);
+        return (Event)construct_raw_key_press_event(raw_event, dequeue_time);
     }
     else if (raw_event->evtype == XI_RawKeyRelease)
     {
-        return (Event)construct_raw_key_release_event(raw_event);
+        return (Event)construct_raw_key_release_event(raw_event, dequeue_time);
     }
     else
     {
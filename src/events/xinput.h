@@ -5,7 +5,9 @@
  * Converts raw XInput2 event data to a standard event structure.
  * 
  * @param raw_event The raw XInput2 event.
+ * @param dequeue_time The monotonic time the event was read from the queue,
+ * or `0` if it isn't tracked.
  * 
  * @return The converted standard event.
  */
-Event convert_raw_xinput_event(XIRawEvent *raw_event);
+Event convert_raw_xinput_event(XIRawEvent *raw_event, uint64_t dequeue_time);
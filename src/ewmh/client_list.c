@@ -9,6 +9,14 @@
  * https://specifications.freedesktop.org/wm-spec/1.5/ar01s03.html#id-1.4.4
  */
 
+static int compare_portals_by_creation(const void *a, const void *b)
+{
+    const Portal *portal_a = *(const Portal **)a;
+    const Portal *portal_b = *(const Portal **)b;
+    if (portal_a->creation_sequence == portal_b->creation_sequence) return 0;
+    return portal_a->creation_sequence < portal_b->creation_sequence ? -1 : 1;
+}
+
 static void update_ewmh_client_list(Portal *exclude)
 {
     Display *display = DefaultDisplay;
@@ -16,33 +24,43 @@ static void update_ewmh_client_list(Portal *exclude)
 
     // Retrieve all portals.
     unsigned int portal_count = 0;
-    Portal *portals = get_unsorted_portals(&portal_count);
+    Portal **portals = get_unsorted_portals(&portal_count);
 
     // Allocate memory for the client list, the size being the largest possible
     // number of top-level client windows.
+    Portal **client_portals = malloc(portal_count * sizeof(Portal *));
     Window *client_list = malloc(portal_count * sizeof(Window));
-    if (client_list == NULL)
+    if (client_portals == NULL || client_list == NULL)
     {
         LOG_ERROR("Could not update EWMH client list, memory allocation failed.");
+        free(client_portals);
+        free(client_list);
         return;
     }
 
-    // Populate the client list with client windows that belong to portals
-    // that are initialized and top-level.
+    // Collect the portals that are initialized and top-level.
     int clients_added = 0;
     for (int i = 0; i < (int)portal_count; i++)
     {
-        Portal *portal = &portals[i];
+        Portal *portal = portals[i];
 
         if (portal == NULL) continue;
         if (portal == exclude) continue;
         if (portal->initialized == false) continue;
         if (portal->top_level == false) continue;
 
-        client_list[clients_added] = portal->client_window;
+        client_portals[clients_added] = portal;
         clients_added++;
     }
 
+    // Order the client windows oldest first, as required by EWMH, since the
+    // registry doesn't keep portals in the order they were created.
+    qsort(client_portals, clients_added, sizeof(Portal *), compare_portals_by_creation);
+    for (int i = 0; i < clients_added; i++)
+    {
+        client_list[i] = client_portals[i]->client_window;
+    }
+
     // Update the `_NET_CLIENT_LIST` property on the root window.
     unsigned char *cast_client_list = (unsigned char *)client_list;
     Atom _NET_CLIENT_LIST = XInternAtom(display, "_NET_CLIENT_LIST", False);
@@ -58,6 +76,7 @@ static void update_ewmh_client_list(Portal *exclude)
     );
 
     // Free the client list.
+    free(client_portals);
     free(client_list);
 }
 
@@ -6,15 +6,25 @@ static const char *libraries[] = {
     "libXfixes.so.3",
     "libXrandr.so.2",
     "libXcomposite.so.1",
+    "libXdamage.so.1",
+    "libXpresent.so.1",
+    "libXext.so.6",
     "libcairo.so.2",
     "libdbus-1.so.3",
 };
 
 static int custom_x_error_handler(Display *display, XErrorEvent *error)
 {
+    // Let the compositor stop waiting for a presentation that failed.
+    handle_presentation_error(error);
+
     // Ignore BadWindow errors.
     if (error->error_code == BadWindow) return 0;
 
+    // Ignore errors of requests known to race against clients unmapping or
+    // destroying their windows.
+    if (x_is_error_ignored(error)) return 0;
+
     // Retrieve the error text.
     char error_text[1024];
     XGetErrorText(display, error->error_code, error_text, sizeof(error_text));
@@ -28,7 +38,7 @@ static int custom_x_error_handler(Display *display, XErrorEvent *error)
     return 0;
 }
 
-int main()
+int main(int argc, char **argv)
 {
     // Ensure the program isn't being run as root.
     if (geteuid() == 0)
@@ -58,6 +68,17 @@ int main()
         }
     }
 
+    // Load the event trace to replay, if one was given.
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0)
+    {
+        if (load_event_trace(argv[2]) != 0) exit(EXIT_FAILURE);
+    }
+    else if (argc > 1)
+    {
+        LOG_ERROR("Usage: %s [--replay <trace>]", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
     // Open the X11 display.
     Display *display = XOpenDisplay(NULL);
     if (!display)
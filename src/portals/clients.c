@@ -34,6 +34,10 @@ int destroy_portal_client(Portal *portal)
     {
         int status = XDestroyWindow(display, client_window);
         if (status == 0) return -2;
+
+        // Remove the client window from the window lookup index before
+        // forgetting it, so its XID can't resolve to this portal anymore.
+        unregister_portal_window(client_window);
         portal->client_window = 0;
     }
 
@@ -190,5 +194,5 @@ HANDLE(ConfigureNotify)
     }
 
     // Synchronize the portal geometry.
-    synchronize_portal(portal);
+    synchronize_portal(portal, _event);
 }
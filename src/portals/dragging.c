@@ -7,7 +7,7 @@ static int mouse_start_root_x = 0, mouse_start_root_y = 0;
 static int portal_start_x = 0, portal_start_y = 0;
 
 static int throttle_ms = 0;
-static Time last_drag_time = 0;
+static uint64_t last_drag_time = 0;
 
 static void start_dragging_portal(Portal *portal, int mouse_root_x, int mouse_root_y)
 {
@@ -22,10 +22,10 @@ static void start_dragging_portal(Portal *portal, int mouse_root_x, int mouse_ro
     add_marker(string_to_id("dragging_portal"), XC_fleur, true);
 }
 
-static void update_dragging_portal(int mouse_root_x, int mouse_root_y, Time event_time)
+static void update_dragging_portal(int mouse_root_x, int mouse_root_y, uint64_t event_time)
 {
     // Throttle the dragging to prevent excessive updates.
-    if (event_time - last_drag_time < (Time)throttle_ms) return;
+    if (event_time - last_drag_time < (uint64_t)throttle_ms * 1000000ULL) return;
 
     // Calculate the new portal position.
     int new_portal_x = portal_start_x + (mouse_root_x - mouse_start_root_x);
@@ -91,37 +91,23 @@ HANDLE(RawButtonRelease)
 
 HANDLE(RawMotionNotify)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
     // Get the current pointer position since RawMotionNotify doesn't include it.
     int pointer_x_root = 0, pointer_y_root = 0;
-    Window child_window = None;
-    XQueryPointer(
-        display,            // Display
-        root_window,        // Window
-        &(Window){0},       // Root (Unused)
-        &child_window,      // Child
-        &pointer_x_root,    // Pointer X (Relative to root)
-        &pointer_y_root,    // Pointer Y (Relative to root)
-        &(int){0},          // Window X (Unused)
-        &(int){0},          // Window Y (Unused)
-        &(unsigned int){0}  // Mask (Unused)
-    );
+    get_pointer_position(&pointer_x_root, &pointer_y_root);
 
     // Handle active dragging.
     if (is_dragging)
     {
-        Time current_time = x_get_current_time();
+        uint64_t current_time = get_monotonic_time();
         update_dragging_portal(pointer_x_root, pointer_y_root, current_time);
         return;
     }
 
     // Handle hover cursor for frame/title bar area.
-    Portal *portal = find_portal_by_window(child_window);
+    Portal *portal = find_portal_at_pos(pointer_x_root, pointer_y_root);
     bool in_frame_area = false;
 
-    if (portal != NULL && is_portal_frame_valid(portal))
+    if (portal != NULL && portal->frame_window != None)
     {
         int rel_x = pointer_x_root - portal->x_root;
         int rel_y = pointer_y_root - portal->y_root;
@@ -70,6 +70,10 @@ void create_portal_frame(Portal *portal)
     portal->frame_window = frame_window;
     portal->frame_cr = cr;
     portal->visual = visual;
+    portal->depth = DefaultDepth(display, DefaultScreen(display));
+
+    // Make the portal findable by its frame window.
+    register_portal_window(frame_window, portal);
 
     // Add the client window to our save-set so it survives if the WM exits.
     XAddToSaveSet(display, portal->client_window);
@@ -160,6 +164,7 @@ int destroy_portal_frame(Portal *portal)
     // Destroy the frame window.
     int status = XDestroyWindow(DefaultDisplay, portal->frame_window);
     if (status == 0) return -1;
+    unregister_portal_window(portal->frame_window);
     portal->frame_window = 0;
 
     return 0;
@@ -178,14 +183,14 @@ HANDLE(ThemeChanged)
 {
     // Retrieve all portals from the registry.
     unsigned int count;
-    Portal *portals = get_unsorted_portals(&count);
+    Portal **portals = get_unsorted_portals(&count);
 
     // Redraw each portal's frame.
     for (unsigned int i = 0; i < count; i++)
     {
-        if (is_portal_frame_valid(&portals[i]))
+        if (is_portal_frame_valid(portals[i]))
         {
-            draw_portal_frame(&portals[i]);
+            draw_portal_frame(portals[i]);
         }
     }
 }
@@ -3,26 +3,13 @@
 HANDLE(RawButtonPress)
 {
     RawButtonPressEvent *_event = &event->raw_button_press;
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
 
-    // Get the pointer's current position and the window under the cursor.
+    // Get the pointer's current position.
     int pointer_x_root = 0, pointer_y_root = 0;
-    Window child_window = None;
-    XQueryPointer(
-        display,            // Display
-        root_window,        // Window
-        &(Window){0},       // Root (Unused)
-        &child_window,      // Child (the window under cursor)
-        &pointer_x_root,    // Pointer X (Relative to root)
-        &pointer_y_root,    // Pointer Y (Relative to root)
-        &(int){0},          // Window X (Unused)
-        &(int){0},          // Window Y (Unused)
-        &(unsigned int){0}  // Mask (Unused)
-    );
-
-    // Find the portal that owns the window under the cursor.
-    Portal *clicked_portal = find_portal_by_window(child_window);
+    get_pointer_position(&pointer_x_root, &pointer_y_root);
+
+    // Find the topmost portal under the cursor.
+    Portal *clicked_portal = find_portal_at_pos(pointer_x_root, pointer_y_root);
     if (clicked_portal == NULL) return;
 
     // Skip override-redirect portals (popups, dropdowns, menus).
@@ -47,26 +34,13 @@ HANDLE(RawButtonPress)
 HANDLE(RawButtonRelease)
 {
     RawButtonReleaseEvent *_event = &event->raw_button_release;
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
 
-    // Get the pointer's current position and the window under the cursor.
+    // Get the pointer's current position.
     int pointer_x_root = 0, pointer_y_root = 0;
-    Window child_window = None;
-    XQueryPointer(
-        display,            // Display
-        root_window,        // Window
-        &(Window){0},       // Root (Unused)
-        &child_window,      // Child (the window under cursor)
-        &pointer_x_root,    // Pointer X (Relative to root)
-        &pointer_y_root,    // Pointer Y (Relative to root)
-        &(int){0},          // Window X (Unused)
-        &(int){0},          // Window Y (Unused)
-        &(unsigned int){0}  // Mask (Unused)
-    );
-
-    // Find the portal that owns the window under the cursor.
-    Portal *portal = find_portal_by_window(child_window);
+    get_pointer_position(&pointer_x_root, &pointer_y_root);
+
+    // Find the topmost portal under the cursor.
+    Portal *portal = find_portal_at_pos(pointer_x_root, pointer_y_root);
     if (portal == NULL) return;
 
     // Calculate the position of the pointer relative to the portal.
@@ -87,26 +61,12 @@ HANDLE(RawButtonRelease)
 
 HANDLE(RawMotionNotify)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
-    // Get the pointer's current position and the window under the cursor.
+    // Get the pointer's current position.
     int pointer_x_root = 0, pointer_y_root = 0;
-    Window child_window = None;
-    XQueryPointer(
-        display,            // Display
-        root_window,        // Window
-        &(Window){0},       // Root (Unused)
-        &child_window,      // Child (the window under cursor)
-        &pointer_x_root,    // Pointer X (Relative to root)
-        &pointer_y_root,    // Pointer Y (Relative to root)
-        &(int){0},          // Window X (Unused)
-        &(int){0},          // Window Y (Unused)
-        &(unsigned int){0}  // Mask (Unused)
-    );
-
-    // Find the portal that owns the window under the cursor.
-    Portal *portal = find_portal_by_window(child_window);
+    get_pointer_position(&pointer_x_root, &pointer_y_root);
+
+    // Find the topmost portal under the cursor.
+    Portal *portal = find_portal_at_pos(pointer_x_root, pointer_y_root);
     if (portal == NULL) return;
 
     // Skip override-redirect portals (popups, dropdowns, menus).
@@ -0,0 +1,151 @@
+/**
+ * This code is responsible for finding portals by their windows.
+ *
+ * Client and frame windows are stored in an open-addressing hash table with
+ * linear probing, mapping each window to its portal. Removed entries are left
+ * behind as tombstones, so probe sequences passing through them stay intact,
+ * and are cleaned up whenever the table is rebuilt.
+ */
+
+#include "../all.h"
+
+/** The initial number of slots in the lookup table, a power of two. */
+#define LOOKUP_INITIAL_CAPACITY 64
+
+/** Marks a slot whose entry has been removed. */
+#define LOOKUP_TOMBSTONE ((Window)~0UL)
+
+typedef struct {
+    Window window;
+    Portal *portal;
+} LookupEntry;
+
+typedef struct {
+    LookupEntry *entries;
+    unsigned int capacity;
+    unsigned int used;
+    unsigned int live;
+} LookupTable;
+
+static LookupTable table = {
+    .entries = NULL,
+    .capacity = 0,
+    .used = 0,
+    .live = 0
+};
+
+static unsigned int hash_window(Window window, unsigned int capacity)
+{
+    // Spread the window ID over the table using Fibonacci hashing, as X11
+    // resource IDs are allocated sequentially.
+    uint64_t hash = (uint64_t)window * 11400714819323198485ULL;
+    return (unsigned int)(hash >> 32) & (capacity - 1);
+}
+
+static int rebuild_table(unsigned int capacity)
+{
+    // Allocate memory for the new entries.
+    LookupEntry *entries = calloc(capacity, sizeof(LookupEntry));
+    if (entries == NULL)
+    {
+        LOG_ERROR("Could not grow portal lookup table, memory allocation failed.");
+        return -1;
+    }
+
+    // Move all live entries over, leaving the tombstones behind.
+    unsigned int used = 0;
+    for (unsigned int i = 0; i < table.capacity; i++)
+    {
+        LookupEntry entry = table.entries[i];
+        if (entry.window == None || entry.window == LOOKUP_TOMBSTONE) continue;
+
+        unsigned int slot = hash_window(entry.window, capacity);
+        while (entries[slot].window != None)
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        entries[slot] = entry;
+        used++;
+    }
+
+    // Replace the old entries.
+    free(table.entries);
+    table.entries = entries;
+    table.capacity = capacity;
+    table.used = used;
+    table.live = used;
+
+    return 0;
+}
+
+static LookupEntry *find_entry(Window window)
+{
+    if (table.capacity == 0) return NULL;
+
+    // Probe until the window or an empty slot is found.
+    unsigned int slot = hash_window(window, table.capacity);
+    for (unsigned int i = 0; i < table.capacity; i++)
+    {
+        LookupEntry *entry = &table.entries[slot];
+        if (entry->window == window) return entry;
+        if (entry->window == None) return NULL;
+        slot = (slot + 1) & (table.capacity - 1);
+    }
+    return NULL;
+}
+
+void register_portal_window(Window window, Portal *portal)
+{
+    if (window == None) return;
+
+    // Replace the portal of an already registered window.
+    LookupEntry *existing_entry = find_entry(window);
+    if (existing_entry != NULL)
+    {
+        existing_entry->portal = portal;
+        return;
+    }
+
+    // Keep the table at most half full, counting tombstones, so probe
+    // sequences stay short. Rebuilding sizes the table for the live entries
+    // only, so tombstones never make it grow.
+    if ((table.used + 1) * 2 > table.capacity)
+    {
+        unsigned int capacity = LOOKUP_INITIAL_CAPACITY;
+        while ((table.live + 1) * 4 > capacity) capacity *= 2;
+        if (rebuild_table(capacity) != 0) return;
+    }
+
+    // Store the entry in the first free slot, reusing tombstones.
+    unsigned int slot = hash_window(window, table.capacity);
+    while (table.entries[slot].window != None && table.entries[slot].window != LOOKUP_TOMBSTONE)
+    {
+        slot = (slot + 1) & (table.capacity - 1);
+    }
+    if (table.entries[slot].window == None) table.used++;
+    table.live++;
+    table.entries[slot] = (LookupEntry){
+        .window = window,
+        .portal = portal
+    };
+}
+
+void unregister_portal_window(Window window)
+{
+    if (window == None) return;
+
+    // Leave a tombstone behind, so later entries remain reachable.
+    LookupEntry *entry = find_entry(window);
+    if (entry == NULL) return;
+    entry->window = LOOKUP_TOMBSTONE;
+    entry->portal = NULL;
+    table.live--;
+}
+
+Portal *lookup_portal_window(Window window)
+{
+    if (window == None) return NULL;
+
+    LookupEntry *entry = find_entry(window);
+    return (entry != NULL) ? entry->portal : NULL;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Registers a window in the window lookup index, so the portal it belongs to
+ * can be found in constant time.
+ *
+ * @param window A client or frame window.
+ * @param portal The portal the window belongs to.
+ *
+ * @note Registering an already registered window replaces its portal.
+ */
+void register_portal_window(Window window, Portal *portal);
+
+/**
+ * Removes a window from the window lookup index.
+ *
+ * @param window A client or frame window.
+ */
+void unregister_portal_window(Window window);
+
+/**
+ * Looks up the portal a window belongs to in the window lookup index.
+ *
+ * @param window A client or frame window.
+ *
+ * @return - `Portal*` The window is registered to this portal.
+ * @return - `NULL` The window is not registered.
+ */
+Portal *lookup_portal_window(Window window);
@@ -1,53 +1,102 @@
+/**
+ * This code is responsible for the portal registry.
+ *
+ * Portals are allocated in fixed-size slabs which are never moved or freed,
+ * so a `Portal*` remains valid for the entire lifetime of its portal. Freed
+ * portals are kept on a free list for reuse, while live portals are tracked
+ * in a dense array for iteration, where each portal knows its own position
+ * so it can be removed by swapping in the last one. As that reorders the
+ * array, each portal also carries a creation sequence for callers that need
+ * portals in the order they were created.
+ *
+ * Geometry changes are not sent to the X server right away. Instead, they are
+ * queued on the portal and flushed once per frame, so a portal is configured
+ * at most once per frame no matter how often it was moved or resized.
+ */
+
 #include "../all.h"
 
+/** The number of portals allocated at once. */
+#define PORTAL_SLAB_SIZE 32
+
 typedef struct {
-    Portal *unsorted;
-    Portal **sorted;
+    Portal **unsorted;
     unsigned int count;
     unsigned int capacity;
+    Portal **slabs;
+    unsigned int slab_count;
+    Portal **free_portals;
+    unsigned int free_count;
+    Portal **configuring;
+    unsigned int configuring_count;
+    unsigned long next_creation_sequence;
 } PortalRegistry;
 
 static PortalRegistry registry = {
     .unsorted = NULL,
-    .sorted = NULL,
     .count = 0,
-    .capacity = 0
+    .capacity = 0,
+    .slabs = NULL,
+    .slab_count = 0,
+    .free_portals = NULL,
+    .free_count = 0,
+    .configuring = NULL,
+    .configuring_count = 0,
+    .next_creation_sequence = 0
 };
 
 // Tracks the top portal to skip redundant raise_portal calls.
 static Portal *top_portal = NULL;
 
+static int allocate_portal_slab()
+{
+    unsigned int capacity = registry.capacity + PORTAL_SLAB_SIZE;
+
+    // Grow the arrays of portal pointers to fit the new slab. Only pointers
+    // are moved here, never the portals themselves.
+    Portal **new_unsorted = realloc(registry.unsorted, capacity * sizeof(Portal *));
+    if (new_unsorted == NULL) return -1;
+    registry.unsorted = new_unsorted;
+
+    Portal **new_free_portals = realloc(registry.free_portals, capacity * sizeof(Portal *));
+    if (new_free_portals == NULL) return -1;
+    registry.free_portals = new_free_portals;
+
+    Portal **new_configuring = realloc(registry.configuring, capacity * sizeof(Portal *));
+    if (new_configuring == NULL) return -1;
+    registry.configuring = new_configuring;
+
+    Portal **new_slabs = realloc(registry.slabs, (registry.slab_count + 1) * sizeof(Portal *));
+    if (new_slabs == NULL) return -1;
+    registry.slabs = new_slabs;
+
+    // Allocate the slab itself.
+    Portal *slab = calloc(PORTAL_SLAB_SIZE, sizeof(Portal));
+    if (slab == NULL) return -1;
+    registry.slabs[registry.slab_count] = slab;
+    registry.slab_count++;
+    registry.capacity = capacity;
+
+    // Put the new portals on the free list, so the first one is reused first.
+    for (int i = PORTAL_SLAB_SIZE - 1; i >= 0; i--)
+    {
+        registry.free_portals[registry.free_count] = &slab[i];
+        registry.free_count++;
+    }
+
+    return 0;
+}
+
 Portal *create_portal(Window client_window)
 {
     // Choose which client window events we should listen for.
-    XSelectInput(DefaultDisplay, client_window, SubstructureNotifyMask);
-
-    // Increase the portal count.
-    registry.count++;
+    XSelectInput(DefaultDisplay, client_window, SubstructureNotifyMask | PropertyChangeMask);
 
-    // Allocate additional memory, if neccessary.
-    if (registry.count > registry.capacity)
+    // Allocate an additional slab of portals, if neccessary.
+    if (registry.free_count == 0 && allocate_portal_slab() != 0)
     {
-        // Calculate the new capacity.
-        registry.capacity = registry.capacity == 0 ? 2 : registry.capacity * 2;
-
-        // Reallocate memory for the unsorted portals array.
-        Portal *new_unsorted = realloc(registry.unsorted, registry.capacity * sizeof(Portal));
-        if (new_unsorted == NULL) {
-            LOG_ERROR("Could not register portal, memory allocation failed.");
-            registry.count--;
-            return NULL;
-        }
-        registry.unsorted = new_unsorted;
-
-        // Reallocate memory for the sorted portals array.
-        Portal **new_sorted = realloc(registry.sorted, registry.capacity * sizeof(Portal *));
-        if (new_sorted == NULL) {
-            LOG_ERROR("Could not register portal, memory allocation failed.");
-            registry.count--;
-            return NULL;
-        }
-        registry.sorted = new_sorted;
+        LOG_ERROR("Could not register portal, memory allocation failed.");
+        return NULL;
     }
 
     // Allocate memory for the portal title.
@@ -55,12 +104,15 @@ Portal *create_portal(Window client_window)
     if (title == NULL)
     {
         LOG_ERROR("Could not register portal, memory allocation failed.");
-        registry.count--;
         return NULL;
     }
 
-    // Add the portal to the registry.
-    registry.unsorted[registry.count - 1] = (Portal){
+    // Take a portal from the free list.
+    registry.free_count--;
+    Portal *portal = registry.free_portals[registry.free_count];
+
+    // Initialize the portal.
+    *portal = (Portal){
         .title = title,
         .client_window_type = None,
         .initialized = false,
@@ -72,14 +124,39 @@ Portal *create_portal(Window client_window)
         .height = 1,
         .frame_window = None,
         .frame_cr = NULL,
-        .client_window = client_window
+        .client_window = client_window,
+        .visual = NULL,
+        .depth = 0,
+        .window_pixmap = None,
+        .window_surface = NULL,
+        .damage = None,
+        .composited_bounds = { 0, 0, 0, 0 },
+        .opaque_region = NULL,
+        .luminance = 0.0f,
+        .luminance_outdated = true,
+        .bypass_compositor = 0,
+        .registry_index = registry.count,
+        .stack_below = NULL,
+        .stack_above = NULL,
+        .stacked = false,
+        .stack_index = 0,
+        .spatially_indexed = false,
+        .spatial_cells = { 0, 0, 0, 0 },
+        .configure_serial = 0,
+        .pending_configure = 0,
+        .creation_sequence = registry.next_creation_sequence
     };
+    registry.next_creation_sequence++;
 
-    // Store the portal in a variable for easier access.
-    Portal *portal = &registry.unsorted[registry.count - 1];
+    // Add the portal to the registry.
+    registry.unsorted[registry.count] = portal;
+    registry.count++;
 
-    // Re-sort the portals.
-    sort_portals();
+    // Make the portal findable by its client window.
+    register_portal_window(client_window, portal);
+
+    // Stack the portal on top, where the X server places new windows.
+    add_portal_to_stack(portal);
 
     // Call all event handlers of the PortalCreated event.
     call_event_handlers((Event*)&(PortalCreatedEvent){
@@ -130,20 +207,40 @@ void destroy_portal(Portal *portal)
         }
 
         // Free the allocated memory for the title.
-        free(registry.unsorted[index].title);
+        free(portal->title);
+
+        // Remove the portal windows from the window lookup index.
+        unregister_portal_window(portal->client_window);
+        unregister_portal_window(portal->frame_window);
 
-        // Overwrite target portal by shifting all subsequent portals.
-        for (int i = index; i < (int)registry.count - 1; i++)
+        // Remove the portal from the stacking order.
+        remove_portal_from_stack(portal);
+
+        // Drop the queued geometry changes of the portal.
+        if (portal->pending_configure != 0)
         {
-            registry.unsorted[i] = registry.unsorted[i + 1];
+            for (unsigned int i = 0; i < registry.configuring_count; i++)
+            {
+                if (registry.configuring[i] != portal) continue;
+                registry.configuring_count--;
+                registry.configuring[i] = registry.configuring[registry.configuring_count];
+                break;
+            }
         }
 
+        // Fill the gap with the last portal.
+        Portal *last_portal = registry.unsorted[registry.count - 1];
+        registry.unsorted[index] = last_portal;
+        last_portal->registry_index = index;
+
         // Decrease the portal count.
         registry.count--;
-    }
 
-    // Re-sort the portals.
-    sort_portals();
+        // Clear the portal, and return it to the free list for reuse.
+        *portal = (Portal){ 0 };
+        registry.free_portals[registry.free_count] = portal;
+        registry.free_count++;
+    }
 }
 
 void initialize_portal(Portal *portal)
@@ -197,6 +294,7 @@ void initialize_portal(Portal *portal)
         client_width = client_attrs.width;
         client_height = client_attrs.height;
         portal->visual = client_attrs.visual;
+        portal->depth = client_attrs.depth;
         portal->override_redirect = client_attrs.override_redirect;
     }
 
@@ -211,6 +309,17 @@ void initialize_portal(Portal *portal)
         portal->height = client_height + PORTAL_TITLE_BAR_HEIGHT;
 
         create_portal_frame(portal);
+
+        // The frame window is created on top of all other windows.
+        move_portal_to_stack_top(portal);
+    }
+    else
+    {
+        // Without a frame, the portal geometry is the client geometry.
+        portal->x_root = client_x_root;
+        portal->y_root = client_y_root;
+        portal->width = client_width;
+        portal->height = client_height;
     }
 
     // Set the portal as initialized.
@@ -223,165 +332,34 @@ void initialize_portal(Portal *portal)
     });
 }
 
-void sort_portals()
+static void queue_portal_configure(Portal *portal, unsigned int value_mask)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
-    // Retrieve all windows in stacking order.
-    Window *windows = NULL;
-    unsigned int window_count = 0;
-    int status = x_query_tree_recursively(
-        display,        // Display
-        root_window,    // Parent
-        &windows,       // Children
-        &window_count   // Children count
-    );
-    if (status != 0)
+    // Add the portal to the queue, unless it is already waiting in it.
+    if (portal->pending_configure == 0)
     {
-        LOG_ERROR("Could not sort portals, tree query failed (%d).", status);
-        free(windows);
-        return;
+        registry.configuring[registry.configuring_count] = portal;
+        registry.configuring_count++;
     }
 
-    // Build sorted portals array from windows array.
-    int portals_added = 0;
-    for (int i = 0; i < (int)window_count; i++)
-    {
-        // Ensure the window belongs to a portal.
-        Portal *portal = find_portal_by_window(windows[i]);
-        if (portal == NULL) continue;
-
-        // Ensure we only handle client windows, and not frame windows as well,
-        // preventing duplicate entries in the sorted portals array.
-        if (windows[i] != portal->client_window) continue;
-
-        // Add portal to the sorted array.
-        registry.sorted[portals_added] = portal;
-        portals_added++;
-    }
-
-    // Clear remaining slots, if any.
-    while (portals_added < (int)registry.count) {
-        registry.sorted[portals_added] = NULL;
-        portals_added++;
-    }
+    // Merge the changes with the ones already queued.
+    portal->pending_configure |= value_mask;
 
-    // Cleanup.
-    free(windows);
+    // Schedule a frame, so the queue is flushed.
+    request_update();
 }
 
 void move_portal(Portal *portal, int x_root, int y_root)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
     // Ensure the portal has been initialized.
     if (portal->initialized == false) return;
 
-    // Move the portal itself.
+    // Skip if the portal is already at the position.
+    if (portal->x_root == x_root && portal->y_root == y_root) return;
+
+    // Move the portal itself, and queue the move of its windows.
     portal->x_root = x_root;
     portal->y_root = y_root;
-
-    // Move the portal windows.
-    scope {
-        Window client_window = portal->client_window;
-        Window frame_window = portal->frame_window;
-
-        // Determine which window to move.
-        Window target_window = (is_portal_frame_valid(portal)) ? frame_window : client_window;
-
-        // Check if the target window still exists (may have been destroyed).
-        if (!x_window_exists(display, target_window)) return;
-
-        // The `XMoveWindow()` function expects coordinates relative to the
-        // parent window. So we have to translate the provided root coordinates
-        // to parent coordinates.
-
-        // Retrieve the parent window of the target window.
-        Window parent_window = x_get_window_parent(display, target_window);
-        if (parent_window == None)
-        {
-            // Window was likely destroyed between the exists check and now.
-            return;
-        }
-
-        // Calculate the parent window coordinates relative to root.
-        int parent_x_root = -1, parent_y_root = -1;
-        XTranslateCoordinates(
-            display,        // Display
-            parent_window,  // Source window
-            root_window,    // Reference window
-            0, 0,           // Source window origin coordinates
-            &parent_x_root, // Translated X coordinate
-            &parent_y_root, // Translated Y coordinate
-            &(Window){0}    // Child window (Unused)
-        );
-        if (parent_x_root == -1 || parent_y_root == -1)
-        {
-            LOG_ERROR(
-                "Could not move portal (%p), coordinate translation failed.",
-                (void*)portal
-            );
-            return;
-        }
-
-        // Calculate target window coordinates relative to parent.
-        int x_parent = x_root - parent_x_root;
-        int y_parent = y_root - parent_y_root;
-
-        // Move the target window.
-        XMoveWindow(display, target_window, x_parent, y_parent);
-
-        // According to the ICCCM (Sections 4.1.5 and 4.2.3), when a window 
-        // manager moves a reparented client window, it is responsible for 
-        // sending a synthetic ConfigureNotify event to the client with the 
-        // windows new dimensions and position relative to root.
-        
-        if (is_portal_frame_valid(portal))
-        {
-            // Retrieve the client window dimensions.
-            unsigned int client_width = 0, client_height = 0;
-            Status geometry_status = XGetGeometry(
-                display,            // Display
-                client_window,      // Drawable
-                &(Window){0},       // Root window (Unused)
-                &(int){0},          // X (Relative to parent) (Unused)
-                &(int){0},          // Y (Relative to parent) (Unused)
-                &client_width,      // Width
-                &client_height,     // Height
-                &(unsigned int){0}, // Border width (Unused)
-                &(unsigned int){0}  // Depth (Unused)
-            );
-            if (geometry_status == 0)
-            {
-                LOG_ERROR(
-                    "Could not move portal (%p), "
-                    "client window dimensions unavailable.",
-                    (void*)portal
-                );
-                return;
-            }
-
-            // Notify the client window of its new geometry.
-            XSendEvent(display, client_window, False, StructureNotifyMask, (XEvent*)&(XConfigureEvent) {
-                .type = ConfigureNotify,
-                .display = display,
-                .event = client_window,
-                .window = client_window,
-                .x = x_root,
-                .y = y_root + PORTAL_TITLE_BAR_HEIGHT,
-                .width = client_width,
-                .height = client_height,
-                .border_width = 0,
-                .above = None,
-                .override_redirect = False
-            });
-
-            // Process all pending X events.
-            XSync(display, False);
-        }
-    }
+    queue_portal_configure(portal, CWX | CWY);
 
     // Call all event handlers of the PortalTransformed event.
     call_event_handlers((Event*)&(PortalTransformedEvent) {
@@ -392,79 +370,19 @@ void move_portal(Portal *portal, int x_root, int y_root)
 
 void resize_portal(Portal *portal, unsigned int width, unsigned int height)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
     // Ensure the portal has been initialized.
     if (portal->initialized == false) return;
 
-    // Check if the client window still exists (may have been destroyed).
-    if (!is_portal_client_valid(portal)) return;
+    // Ensure the client window hasn't been destroyed by ourselves.
+    if (portal->client_window == None) return;
 
-    // Resize the portal itself.
+    // Skip if the portal already has the dimensions.
+    if (portal->width == width && portal->height == height) return;
+
+    // Resize the portal itself, and queue the resize of its windows.
     portal->width = width;
     portal->height = height;
-
-    // Resize the portal windows.
-    scope {
-        Window frame_window = portal->frame_window;
-        Window client_window = portal->client_window;
-
-        if (is_portal_frame_valid(portal))
-        {
-            // Resize both the frame and client windows.
-            XResizeWindow(display, frame_window, width, height);
-            XResizeWindow(display, client_window, width, max(1, height - PORTAL_TITLE_BAR_HEIGHT));
-        }
-        else
-        {
-            // No frame, just resize the client window.
-            XResizeWindow(display, client_window, width, height);
-        }
-
-        // According to the ICCCM (Sections 4.1.5 and 4.2.3), when a window
-        // manager resizes a reparented client window, it is responsible for
-        // sending a synthetic ConfigureNotify event to the client with the
-        // windows new dimensions and position relative to root.
-
-        if (is_portal_frame_valid(portal))
-        {
-            // Retrieve the client window position relative to root.
-            int client_x_root = -1, client_y_root = -1;
-            XTranslateCoordinates(
-                display,            // Display
-                client_window,      // Source window
-                root_window,        // Reference window
-                0, 0,               // Source window origin coordinates
-                &client_x_root,     // Translated X coordinate
-                &client_y_root,     // Translated Y coordinate
-                &(Window){0}        // Child window (Unused)
-            );
-            if (client_x_root == -1 || client_y_root == -1)
-            {
-                // Window was likely destroyed during the operation.
-                return;
-            }
-
-            // Notify the client window of its new geometry.
-            XSendEvent(display, client_window, False, StructureNotifyMask, (XEvent*)&(XConfigureEvent) {
-                .type = ConfigureNotify,
-                .display = display,
-                .event = client_window,
-                .window = client_window,
-                .x = client_x_root,
-                .y = client_y_root,
-                .width = max(1, width),
-                .height = max(1, height - PORTAL_TITLE_BAR_HEIGHT),
-                .border_width = 0,
-                .above = None,
-                .override_redirect = False
-            });
-
-            // Process all pending X events.
-            XSync(display, False);
-        }
-    }
+    queue_portal_configure(portal, CWWidth | CWHeight);
 
     // Call all event handlers of the PortalTransformed event.
     call_event_handlers((Event*)&(PortalTransformedEvent){
@@ -473,83 +391,133 @@ void resize_portal(Portal *portal, unsigned int width, unsigned int height)
     });
 }
 
-void synchronize_portal(Portal *portal)
+static void configure_portal_windows(Portal *portal)
 {
     Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
+    Window frame_window = portal->frame_window;
     Window client_window = portal->client_window;
+    bool is_framed = (frame_window != None);
+    unsigned int value_mask = portal->pending_configure;
+
+    // Determine which window carries the portal geometry. Both are children
+    // of root, so the root coordinates can be used as they are.
+    Window target_window = is_framed ? frame_window : client_window;
+    if (target_window == None) return;
+
+    // Remember the request, so configure notifications sent before it can
+    // be told apart.
+    portal->configure_serial = NextRequest(display);
+
+    // Configure the target window with all queued changes at once.
+    XConfigureWindow(display, target_window, value_mask, &(XWindowChanges){
+        .x = portal->x_root,
+        .y = portal->y_root,
+        .width = max(1, portal->width),
+        .height = max(1, portal->height)
+    });
 
-    // Ensure the portal has been initialized.
-    if (portal->initialized == false) return;
+    // Framed portals only need the client window resized, as it is
+    // positioned relative to the frame.
+    if (!is_framed || client_window == None) return;
 
-    // Check if the client window still exists (may have been destroyed).
-    if (!is_portal_client_valid(portal)) return;
+    if (value_mask & (CWWidth | CWHeight))
+    {
+        XConfigureWindow(display, client_window, CWWidth | CWHeight, &(XWindowChanges){
+            .width = max(1, portal->width),
+            .height = max(1, (int)portal->height - PORTAL_TITLE_BAR_HEIGHT)
+        });
+    }
 
-    // Retrieve the client window root coordinates.
-    int client_x_root = 0, client_y_root = 0;
-    XTranslateCoordinates(
-        display,                // Display
-        client_window,          // Source window
-        root_window,            // Reference window
-        0, 0,                   // Source window origin coordinates
-        &client_x_root,         // Translated x coordinate
-        &client_y_root,         // Translated y coordinate
-        &(Window){0}            // Child Window (Unused)
-    );
+    // According to the ICCCM (Sections 4.1.5 and 4.2.3), when a window
+    // manager moves or resizes a reparented client window, it is responsible
+    // for sending a synthetic ConfigureNotify event to the client with the
+    // windows new dimensions and position relative to root.
+    XSendEvent(display, client_window, False, StructureNotifyMask, (XEvent*)&(XConfigureEvent) {
+        .type = ConfigureNotify,
+        .display = display,
+        .event = client_window,
+        .window = client_window,
+        .x = portal->x_root,
+        .y = portal->y_root + PORTAL_TITLE_BAR_HEIGHT,
+        .width = max(1, portal->width),
+        .height = max(1, (int)portal->height - PORTAL_TITLE_BAR_HEIGHT),
+        .border_width = 0,
+        .above = None,
+        .override_redirect = False
+    });
+}
 
-    // Retrieve the client window dimensions.
-    unsigned int client_width = 0, client_height = 0;
-    XGetGeometry(
-        display,                // Display
-        client_window,          // Drawable
-        &(Window){0},           // Root window (Unused)
-        &(int){0},              // X (Relative to parent) (Unused)
-        &(int){0},              // Y (Relative to parent) (Unused)
-        &client_width,          // Width
-        &client_height,         // Height
-        &(unsigned int){0},     // Border width (Unused)
-        &(unsigned int){0}      // Depth (Unused)
-    );
+void flush_portal_configures()
+{
+    // Configure the windows of every portal with queued changes. Requests are
+    // only buffered here, and leave with the next flush of the connection.
+    for (unsigned int i = 0; i < registry.configuring_count; i++)
+    {
+        Portal *portal = registry.configuring[i];
+        configure_portal_windows(portal);
+        portal->pending_configure = 0;
+    }
+    registry.configuring_count = 0;
+}
 
-    // Calculate the new portal geometry.
-    bool is_framed = is_portal_frame_valid(portal);
-    int portal_x_root = client_x_root;
-    int portal_y_root = client_y_root + (is_framed ? -PORTAL_TITLE_BAR_HEIGHT : 0);
-    unsigned int portal_width = max(1, client_width);
-    unsigned int portal_height = max(1, client_height + (is_framed ? PORTAL_TITLE_BAR_HEIGHT : 0));
+void synchronize_portal(Portal *portal, XConfigureEvent *configure_event)
+{
+    // Ensure the portal has been initialized.
+    if (portal->initialized == false) return;
 
-    // Move the portal if the position has changed and the portal is not framed.
-    // Framed portals have their position controlled by the WM, not the client.
-    if (!is_framed && (portal_x_root != portal->x_root || portal_y_root != portal->y_root))
+    // Ignore notifications which were sent before our own latest configure
+    // request was processed, as they describe an outdated geometry.
+    if (configure_event->serial < portal->configure_serial) return;
+
+    // Calculate the new portal geometry. Framed client windows are
+    // positioned relative to their frame, others relative to root.
+    bool is_framed = (portal->frame_window != None);
+    int portal_x_root = configure_event->x;
+    int portal_y_root = configure_event->y;
+    unsigned int portal_width = max(1, configure_event->width);
+    unsigned int portal_height = max(1, configure_event->height + (is_framed ? PORTAL_TITLE_BAR_HEIGHT : 0));
+
+    // Unframed portals are placed by their clients, and the reported geometry
+    // is already applied to the client window. Adopt it without configuring
+    // the window again, keeping only the changes we queued ourselves.
+    if (!is_framed)
     {
-        move_portal(portal, portal_x_root, portal_y_root);
+        unsigned int pending_configure = portal->pending_configure;
+        if (pending_configure & CWX) portal_x_root = portal->x_root;
+        if (pending_configure & CWY) portal_y_root = portal->y_root;
+        if (pending_configure & CWWidth) portal_width = portal->width;
+        if (pending_configure & CWHeight) portal_height = portal->height;
+
+        // Skip if the geometry hasn't changed.
+        if (portal_x_root == portal->x_root && portal_y_root == portal->y_root &&
+            portal_width == portal->width && portal_height == portal->height)
+        {
+            return;
+        }
+
+        portal->x_root = portal_x_root;
+        portal->y_root = portal_y_root;
+        portal->width = portal_width;
+        portal->height = portal_height;
+
+        // Call all event handlers of the PortalTransformed event.
+        call_event_handlers((Event*)&(PortalTransformedEvent){
+            .type = PortalTransformed,
+            .portal = portal
+        });
+        return;
     }
 
-    // Resize the portal, only if the dimensions have changed.
+    // Ignore notifications of framed client windows while changes are queued,
+    // as the queued geometry supersedes them.
+    if (portal->pending_configure != 0) return;
+
+    // Resize the portal, only if the dimensions have changed. Framed portals
+    // have their position controlled by the WM, not the client.
     if (portal_width != portal->width || portal_height != portal->height)
     {
         resize_portal(portal, portal_width, portal_height);
     }
-
-    // Synchronize all child portals as well.
-    Window *child_windows;
-    unsigned int child_window_count = 0;
-    XQueryTree(
-        display,            // Display
-        client_window,      // Window
-        &(Window){0},       // Root window (Unused)
-        &(Window){0},       // Parent window (Unused)
-        &child_windows,     // Children
-        &child_window_count // Children count
-    );
-    for (int i = 0; i < (int)child_window_count; i++)
-    {
-        Portal *child_portal = find_portal_by_window(child_windows[i]);
-        if (child_portal != NULL)
-        {
-            synchronize_portal(child_portal);
-        }
-    }
 }
 
 Portal *get_top_portal()
@@ -562,7 +530,7 @@ void raise_portal(Portal *portal)
     // Ensure the portal has been initialized.
     if (portal->initialized == false) return;
 
-    // Skip if already on top (sort_portals is expensive).
+    // Skip if already on top.
     if (top_portal == portal) return;
 
     // Determine which window to raise.
@@ -573,8 +541,8 @@ void raise_portal(Portal *portal)
     // Raise the portal windows.
     XRaiseWindow(DefaultDisplay, target_window);
 
-    // Re-sort the portals.
-    sort_portals();
+    // Mirror the raise in the stacking order.
+    move_portal_to_stack_top(portal);
 
     // Track the top portal.
     top_portal = portal;
@@ -676,9 +644,6 @@ void map_portal(Portal *portal)
         }
     }
 
-    // Synchronize the portal geometry.
-    synchronize_portal(portal);
-
     // Handle transient windows (dialogs, popups) - they should be raised above
     // their parent window per ICCCM.
     Window transient_for = None;
@@ -729,17 +694,16 @@ void unmap_portal(Portal *portal)
 
 int get_portal_index(Portal *portal)
 {
-    for (int i = 0; i < (int)registry.count; i++)
+    // Ensure the portal is live, as freed portals are cleared.
+    unsigned int index = portal->registry_index;
+    if (index >= registry.count || registry.unsorted[index] != portal)
     {
-        if (&registry.unsorted[i] == portal)
-        {
-            return i;
-        }
+        return -1;
     }
-    return -1;
+    return index;
 }
 
-Portal *get_unsorted_portals(unsigned int *out_count)
+Portal **get_unsorted_portals(unsigned int *out_count)
 {
     *out_count = registry.count;
     return registry.unsorted;
@@ -747,52 +711,19 @@ Portal *get_unsorted_portals(unsigned int *out_count)
 
 Portal **get_sorted_portals(unsigned int *out_count)
 {
-    *out_count = registry.count;
-    return registry.sorted;
+    return get_stacked_portals(out_count);
 }
 
 Portal *find_portal_by_window(Window window)
 {
-    // Iterate over the unsorted portals to find the portal associated with
-    // the specified window.
-    for (int i = 0; i < (int)registry.count; i++)
-    {
-        Portal *portal = &registry.unsorted[i];
-
-        // Skip invalid portals.
-        if (portal == NULL) continue;
-
-        // Check if the portal is associated with the specified window.
-        if (portal->frame_window == window ||
-            portal->client_window == window)
-        {
-            return portal;
-        }
-    }
-    return NULL;
+    // Look up the portal associated with the specified window in the window
+    // lookup index, which tracks both client and frame windows.
+    return lookup_portal_window(window);
 }
 
 Portal *find_portal_at_pos(int x_root, int y_root)
 {
-    // Iterate over the sorted portals in reverse order, to find the topmost
-    // portal at the specified position.
-    for (int i = registry.count - 1; i >= 0; i--)
-    {
-        Portal *portal = registry.sorted[i];
-
-        // Skip invalid portals.
-        if (portal == NULL) continue;
-        if (portal->initialized == false) continue;
-        if (portal->mapped == false) continue;
-
-        // Check if the portal is located at the specified position.
-        if (x_root >= portal->x_root &&
-            y_root >= portal->y_root &&
-            x_root < portal->x_root + (int)portal->width &&
-            y_root < portal->y_root + (int)portal->height)
-        {
-            return portal;
-        }
-    }
-    return NULL;
+    // Look up the topmost portal at the specified position in the spatial
+    // index, which only tracks mapped and initialized portals.
+    return find_spatial_portal_at(x_root, y_root);
 }
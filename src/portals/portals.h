@@ -20,7 +20,7 @@
  * A portal represents a window pair consisting of a decorative frame and the
  * client content area, along with its geometry and rendering state.
  */
-typedef struct {
+typedef struct Portal {
     char *title;
     bool initialized;
     bool top_level;
@@ -33,13 +33,27 @@ typedef struct {
     Window client_window;
     Atom client_window_type;
     Visual *visual;
+    int depth;
+    Pixmap window_pixmap;
+    cairo_surface_t *window_surface;
+    Damage damage;
+    cairo_rectangle_int_t composited_bounds;
+    cairo_region_t *opaque_region;
+    float luminance;
+    bool luminance_outdated;
+    unsigned long bypass_compositor;
+    unsigned int registry_index;
+    struct Portal *stack_below;
+    struct Portal *stack_above;
+    bool stacked;
+    unsigned int stack_index;
+    bool spatially_indexed;
+    cairo_rectangle_int_t spatial_cells;
+    unsigned long configure_serial;
+    unsigned int pending_configure;
+    unsigned long creation_sequence;
 } Portal;
 
-/**
- * Sorts portals in the registry based on their stacking order.
- */
-void sort_portals();
-
 /**
  * Creates a portal and registers it to the portal registry.
  * 
@@ -66,6 +80,9 @@ void destroy_portal(Portal *portal);
  * @param portal The portal to move.
  * @param x_root The new X coordinate relative to root.
  * @param y_root The new Y coordinate relative to root.
+ *
+ * @note The portal windows are only moved once the next frame flushes the
+ * queued geometry changes.
  */
 void move_portal(Portal *portal, int x_root, int y_root);
 
@@ -75,15 +92,34 @@ void move_portal(Portal *portal, int x_root, int y_root);
  * @param portal The portal to resize.
  * @param width The new width in pixels.
  * @param height The new height in pixels.
+ *
+ * @note The portal windows are only resized once the next frame flushes the
+ * queued geometry changes.
  */
 void resize_portal(Portal *portal, unsigned int width, unsigned int height);
 
 /**
- * Synchronizes the portal's stored geometry with its actual window geometry.
+ * Sends the queued geometry changes of all portals to the X server, using a
+ * single configure request per window and a single synthetic ConfigureNotify
+ * per framed client window.
+ *
+ * @note Called once per frame, right before compositing.
+ */
+void flush_portal_configures();
+
+/**
+ * Synchronizes the portal's stored geometry with the client window geometry
+ * reported by a ConfigureNotify event.
  *
  * @param portal The portal to synchronize.
+ * @param configure_event The ConfigureNotify event of the client window.
+ *
+ * @note Notifications sent before our latest configure request of the portal
+ * are ignored, as they describe an outdated geometry. Unframed portals adopt
+ * the reported geometry as is, except for changes still queued by ourselves,
+ * while framed portals ignore notifications as long as changes are queued.
  */
-void synchronize_portal(Portal *portal);
+void synchronize_portal(Portal *portal, XConfigureEvent *configure_event);
 
 /**
  * Returns the top portal in the stacking order.
@@ -125,18 +161,23 @@ void unmap_portal(Portal *portal);
 int get_portal_index(Portal *portal);
 
 /**
- * Retrieves the unsorted array of portals from the registry.
+ * Retrieves the unsorted array of portal pointers from the registry.
  *
  * @param out_count Pointer to store the number of portals.
  *
- * @return The unsorted portal array.
+ * @return The unsorted portal pointer array.
+ *
+ * @note Portals never move in memory, but their order in this array changes
+ * as portals are destroyed. Callers which need the portals in the order they
+ * were created must sort them by `creation_sequence`.
  */
-Portal *get_unsorted_portals(unsigned int *out_count);
+Portal **get_unsorted_portals(unsigned int *out_count);
 
 /**
  * Retrieves the sorted array of portal pointers from the registry.
  *
- * Portals are sorted by stacking order (bottom to top).
+ * Portals are sorted by stacking order (bottom to top), which is tracked
+ * incrementally and only reconciled with the X server when necessary.
  *
  * @param out_count Pointer to store the number of portals.
  *
@@ -9,7 +9,7 @@ static int mouse_start_root_x = 0, mouse_start_root_y = 0;
 static int portal_start_width = 0, portal_start_height = 0;
 
 static int throttle_ms = 0;
-static Time last_resize_time = 0;
+static uint64_t last_resize_time = 0;
 
 bool is_portal_resize_area(Portal *portal, int rel_x, int rel_y)
 {
@@ -33,10 +33,10 @@ static void start_resizing_portal(Portal *portal, int mouse_root_x, int mouse_ro
     add_marker(string_to_id("resizing_portal"), XC_bottom_right_corner, true);
 }
 
-static void update_resizing_portal(int mouse_root_x, int mouse_root_y, Time event_time)
+static void update_resizing_portal(int mouse_root_x, int mouse_root_y, uint64_t event_time)
 {
     // Throttle the resizing to prevent excessive updates.
-    if (event_time - last_resize_time < (Time)throttle_ms) return;
+    if (event_time - last_resize_time < (uint64_t)throttle_ms * 1000000ULL) return;
 
     // Determine minimum dimensions from client hints or use defaults.
     int min_width = MINIMUM_PORTAL_WIDTH;
@@ -122,36 +122,22 @@ HANDLE(RawButtonRelease)
 
 HANDLE(RawMotionNotify)
 {
-    Display *display = DefaultDisplay;
-    Window root_window = DefaultRootWindow(display);
-
     // Get the current pointer position since RawMotionNotify doesn't include it.
     int pointer_x_root = 0, pointer_y_root = 0;
-    Window child_window = None;
-    XQueryPointer(
-        display,            // Display
-        root_window,        // Window
-        &(Window){0},       // Root (Unused)
-        &child_window,      // Child
-        &pointer_x_root,    // Pointer X (Relative to root)
-        &pointer_y_root,    // Pointer Y (Relative to root)
-        &(int){0},          // Window X (Unused)
-        &(int){0},          // Window Y (Unused)
-        &(unsigned int){0}  // Mask (Unused)
-    );
+    get_pointer_position(&pointer_x_root, &pointer_y_root);
 
     // Handle active resizing.
     if (is_resizing)
     {
-        Time current_time = x_get_current_time();
+        uint64_t current_time = get_monotonic_time();
         update_resizing_portal(pointer_x_root, pointer_y_root, current_time);
         return;
     }
 
     // Handle hover cursor for resize area.
-    Portal *portal = find_portal_by_window(child_window);
+    Portal *portal = find_portal_at_pos(pointer_x_root, pointer_y_root);
     bool in_resize_area = false;
-    if (portal != NULL && is_portal_frame_valid(portal))
+    if (portal != NULL && portal->frame_window != None)
     {
         int rel_x = pointer_x_root - portal->x_root;
         int rel_y = pointer_y_root - portal->y_root;
@@ -0,0 +1,192 @@
+/**
+ * This code is responsible for locating portals by position.
+ *
+ * The screen is divided into a uniform grid of cells, where each cell lists
+ * the mapped portals overlapping it. Hit-testing a point then only has to
+ * look at the portals of a single cell, and picks the topmost one using the
+ * stacking index of each portal. The grid is kept up to date from portal
+ * events, so lookups never need to ask the X server.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    Portal **portals;
+    unsigned int count;
+    unsigned int capacity;
+} SpatialCell;
+
+static SpatialCell *cells = NULL;
+static int column_count = 0;
+static int row_count = 0;
+
+static SpatialCell *get_cell(int column, int row)
+{
+    return &cells[row * column_count + column];
+}
+
+static int clamp_column(int x_root)
+{
+    int column = (x_root < 0) ? 0 : x_root / SPATIAL_CELL_SIZE;
+    return (column >= column_count) ? column_count - 1 : column;
+}
+
+static int clamp_row(int y_root)
+{
+    int row = (y_root < 0) ? 0 : y_root / SPATIAL_CELL_SIZE;
+    return (row >= row_count) ? row_count - 1 : row;
+}
+
+static void add_portal_to_cell(SpatialCell *cell, Portal *portal)
+{
+    // Grow the cell, if necessary.
+    if (cell->count == cell->capacity)
+    {
+        unsigned int capacity = (cell->capacity == 0) ? 4 : cell->capacity * 2;
+        Portal **new_portals = realloc(cell->portals, capacity * sizeof(Portal *));
+        if (new_portals == NULL)
+        {
+            LOG_ERROR("Could not index portal position, memory allocation failed.");
+            return;
+        }
+        cell->portals = new_portals;
+        cell->capacity = capacity;
+    }
+
+    cell->portals[cell->count] = portal;
+    cell->count++;
+}
+
+static void remove_portal_from_cell(SpatialCell *cell, Portal *portal)
+{
+    // Swap the last portal of the cell into the gap.
+    for (unsigned int i = 0; i < cell->count; i++)
+    {
+        if (cell->portals[i] != portal) continue;
+        cell->portals[i] = cell->portals[cell->count - 1];
+        cell->count--;
+        return;
+    }
+}
+
+static void remove_portal_from_index(Portal *portal)
+{
+    if (!portal->spatially_indexed) return;
+
+    // Remove the portal from every cell it was added to.
+    cairo_rectangle_int_t range = portal->spatial_cells;
+    for (int row = range.y; row < range.y + range.height; row++)
+    {
+        for (int column = range.x; column < range.x + range.width; column++)
+        {
+            remove_portal_from_cell(get_cell(column, row), portal);
+        }
+    }
+    portal->spatially_indexed = false;
+}
+
+static void add_portal_to_index(Portal *portal)
+{
+    if (cells == NULL) return;
+    if (portal->mapped == false || portal->initialized == false) return;
+    if (portal->width == 0 || portal->height == 0) return;
+
+    // Determine the range of cells the portal overlaps.
+    int first_column = clamp_column(portal->x_root);
+    int first_row = clamp_row(portal->y_root);
+    int last_column = clamp_column(portal->x_root + (int)portal->width - 1);
+    int last_row = clamp_row(portal->y_root + (int)portal->height - 1);
+
+    // Add the portal to every cell in the range.
+    for (int row = first_row; row <= last_row; row++)
+    {
+        for (int column = first_column; column <= last_column; column++)
+        {
+            add_portal_to_cell(get_cell(column, row), portal);
+        }
+    }
+    portal->spatial_cells = (cairo_rectangle_int_t){
+        first_column,
+        first_row,
+        last_column - first_column + 1,
+        last_row - first_row + 1
+    };
+    portal->spatially_indexed = true;
+}
+
+static bool is_portal_at(Portal *portal, int x_root, int y_root)
+{
+    return (
+        x_root >= portal->x_root &&
+        y_root >= portal->y_root &&
+        x_root < portal->x_root + (int)portal->width &&
+        y_root < portal->y_root + (int)portal->height
+    );
+}
+
+Portal *find_spatial_portal_at(int x_root, int y_root)
+{
+    if (cells == NULL) return NULL;
+
+    // Ensure the stacking index of every portal is up to date.
+    get_sorted_portals(&(unsigned int){0});
+
+    // Pick the topmost portal of the cell which contains the position.
+    SpatialCell *cell = get_cell(clamp_column(x_root), clamp_row(y_root));
+    Portal *top_portal = NULL;
+    for (unsigned int i = 0; i < cell->count; i++)
+    {
+        Portal *portal = cell->portals[i];
+        if (!is_portal_at(portal, x_root, y_root)) continue;
+        if (top_portal == NULL || portal->stack_index > top_portal->stack_index)
+        {
+            top_portal = portal;
+        }
+    }
+    return top_portal;
+}
+
+HANDLE(Initialize)
+{
+    Display *display = DefaultDisplay;
+    int screen = DefaultScreen(display);
+
+    // Divide the screen into cells, rounding up to cover partial cells.
+    int screen_width = DisplayWidth(display, screen);
+    int screen_height = DisplayHeight(display, screen);
+    column_count = (screen_width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+    row_count = (screen_height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+    if (column_count < 1) column_count = 1;
+    if (row_count < 1) row_count = 1;
+
+    // Allocate memory for the cells.
+    cells = calloc(column_count * row_count, sizeof(SpatialCell));
+    if (cells == NULL)
+    {
+        LOG_ERROR("Could not create spatial index, memory allocation failed.");
+    }
+}
+
+HANDLE(PortalMapped)
+{
+    Portal *portal = event->portal_mapped.portal;
+    remove_portal_from_index(portal);
+    add_portal_to_index(portal);
+}
+
+HANDLE(PortalUnmapped)
+{
+    remove_portal_from_index(event->portal_unmapped.portal);
+}
+
+HANDLE(PortalTransformed)
+{
+    Portal *portal = event->portal_transformed.portal;
+    remove_portal_from_index(portal);
+    add_portal_to_index(portal);
+}
+
+HANDLE(PortalDestroyed)
+{
+    remove_portal_from_index(event->portal_destroyed.portal);
+}
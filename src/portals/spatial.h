@@ -0,0 +1,17 @@
+#pragma once
+#include "../all.h"
+
+/** The width and height of a spatial index cell in pixels. */
+#define SPATIAL_CELL_SIZE 256
+
+/**
+ * Finds the topmost mapped portal at the specified position, using the
+ * spatial index.
+ *
+ * @param x_root The X coordinate relative to root.
+ * @param y_root The Y coordinate relative to root.
+ *
+ * @return - `Portal*` The portal was found.
+ * @return - `NULL` No portal is located at the position.
+ */
+Portal *find_spatial_portal_at(int x_root, int y_root);
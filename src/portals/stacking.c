@@ -0,0 +1,240 @@
+/**
+ * This code is responsible for tracking the stacking order of portals.
+ *
+ * Portals are kept in an intrusive doubly linked list (bottom to top), which
+ * is updated from our own restacking requests and from the sibling reported
+ * in ConfigureNotify events of root children. The X server is only queried
+ * when a restack can't be placed relative to a known portal, and then only
+ * once, when the stacking order is next needed.
+ */
+
+#include "../all.h"
+
+typedef struct {
+    Portal *bottom;
+    Portal *top;
+    unsigned int count;
+    bool outdated;
+    Portal **array;
+    unsigned int array_capacity;
+    bool array_outdated;
+} PortalStack;
+
+static PortalStack stack = {
+    .bottom = NULL,
+    .top = NULL,
+    .count = 0,
+    .outdated = false,
+    .array = NULL,
+    .array_capacity = 0,
+    .array_outdated = false
+};
+
+static Window get_stacking_window(Portal *portal)
+{
+    // Frame windows are the root children of framed portals.
+    return (portal->frame_window != None) ? portal->frame_window : portal->client_window;
+}
+
+static void unlink_portal(Portal *portal)
+{
+    if (portal->stack_below != NULL) portal->stack_below->stack_above = portal->stack_above;
+    else stack.bottom = portal->stack_above;
+
+    if (portal->stack_above != NULL) portal->stack_above->stack_below = portal->stack_below;
+    else stack.top = portal->stack_below;
+
+    portal->stack_below = NULL;
+    portal->stack_above = NULL;
+    portal->stacked = false;
+    stack.count--;
+    stack.array_outdated = true;
+}
+
+static void link_portal_above(Portal *portal, Portal *sibling)
+{
+    // Insert at the bottom if there is no sibling to stack above.
+    Portal *below = sibling;
+    Portal *above = (sibling != NULL) ? sibling->stack_above : stack.bottom;
+
+    portal->stack_below = below;
+    portal->stack_above = above;
+    if (below != NULL) below->stack_above = portal;
+    else stack.bottom = portal;
+    if (above != NULL) above->stack_below = portal;
+    else stack.top = portal;
+
+    portal->stacked = true;
+    stack.count++;
+    stack.array_outdated = true;
+}
+
+void add_portal_to_stack(Portal *portal)
+{
+    if (portal->stacked) return;
+    link_portal_above(portal, stack.top);
+}
+
+void remove_portal_from_stack(Portal *portal)
+{
+    if (!portal->stacked) return;
+    unlink_portal(portal);
+}
+
+void move_portal_to_stack_top(Portal *portal)
+{
+    if (!portal->stacked) return;
+    if (stack.top == portal) return;
+    unlink_portal(portal);
+    link_portal_above(portal, stack.top);
+}
+
+void invalidate_portal_stack()
+{
+    stack.outdated = true;
+}
+
+void reconcile_portal_stack()
+{
+    Display *display = DefaultDisplay;
+    Window root_window = DefaultRootWindow(display);
+
+    // Retrieve the children of the root window in stacking order. All portal
+    // stacking windows are root children, so there is no need to recurse.
+    Window *windows = NULL;
+    unsigned int window_count = 0;
+    Status status = XQueryTree(
+        display,        // Display
+        root_window,    // Window
+        &(Window){0},   // Root window (Unused)
+        &(Window){0},   // Parent window (Unused)
+        &windows,       // Children
+        &window_count   // Children count
+    );
+    if (status == 0)
+    {
+        LOG_ERROR("Could not reconcile portal stacking order, tree query failed.");
+        return;
+    }
+
+    // Remember the current order, so portals missing from the tree keep
+    // their relative order.
+    unsigned int previous_count = stack.count;
+    Portal **previous = malloc(previous_count * sizeof(Portal *));
+    if (previous == NULL && previous_count > 0)
+    {
+        LOG_ERROR("Could not reconcile portal stacking order, memory allocation failed.");
+        if (windows != NULL) XFree(windows);
+        return;
+    }
+    scope {
+        unsigned int i = 0;
+        for (Portal *portal = stack.bottom; portal != NULL; portal = portal->stack_above)
+        {
+            previous[i++] = portal;
+        }
+    }
+
+    // Empty the stack.
+    for (unsigned int i = 0; i < previous_count; i++)
+    {
+        unlink_portal(previous[i]);
+    }
+
+    // Stack the portals as the X server reports them.
+    for (unsigned int i = 0; i < window_count; i++)
+    {
+        Portal *portal = find_portal_by_window(windows[i]);
+        if (portal == NULL || portal->stacked) continue;
+        if (windows[i] != get_stacking_window(portal)) continue;
+        link_portal_above(portal, stack.top);
+    }
+
+    // Put portals missing from the tree at the bottom, in their old order.
+    for (int i = (int)previous_count - 1; i >= 0; i--)
+    {
+        if (!previous[i]->stacked) link_portal_above(previous[i], NULL);
+    }
+
+    // Cleanup.
+    free(previous);
+    if (windows != NULL) XFree(windows);
+    stack.outdated = false;
+}
+
+Portal **get_stacked_portals(unsigned int *out_count)
+{
+    // Reconcile with the X server, if our stacking order can't be trusted.
+    if (stack.outdated) reconcile_portal_stack();
+
+    // Rebuild the array from the list, if the list has changed.
+    if (stack.array_outdated)
+    {
+        // Grow the array, if necessary.
+        if (stack.count > stack.array_capacity)
+        {
+            unsigned int capacity = (stack.array_capacity == 0) ? 16 : stack.array_capacity;
+            while (capacity < stack.count) capacity *= 2;
+            Portal **new_array = realloc(stack.array, capacity * sizeof(Portal *));
+            if (new_array == NULL)
+            {
+                LOG_ERROR("Could not retrieve stacked portals, memory allocation failed.");
+                *out_count = 0;
+                return stack.array;
+            }
+            stack.array = new_array;
+            stack.array_capacity = capacity;
+        }
+
+        // Copy the list into the array, and let each portal know its index
+        // for quick stacking comparisons.
+        unsigned int i = 0;
+        for (Portal *portal = stack.bottom; portal != NULL; portal = portal->stack_above)
+        {
+            portal->stack_index = i;
+            stack.array[i++] = portal;
+        }
+        stack.array_outdated = false;
+    }
+
+    *out_count = stack.count;
+    return stack.array;
+}
+
+HANDLE(ConfigureNotify)
+{
+    XConfigureEvent *_event = &event->xconfigure;
+    Window root_window = DefaultRootWindow(DefaultDisplay);
+
+    // Ensure the event is about a root child, as reported through the
+    // substructure of the root window.
+    if (_event->event != root_window) return;
+
+    // Ensure the window is the stacking window of a portal.
+    Portal *portal = find_portal_by_window(_event->window);
+    if (portal == NULL || !portal->stacked) return;
+    if (_event->window != get_stacking_window(portal)) return;
+
+    // Place the portal at the bottom, if it has no sibling below it.
+    if (_event->above == None)
+    {
+        if (stack.bottom == portal) return;
+        unlink_portal(portal);
+        link_portal_above(portal, NULL);
+        return;
+    }
+
+    // Ensure the sibling below is the stacking window of a portal, otherwise
+    // the position can't be determined without asking the X server.
+    Portal *sibling = find_portal_by_window(_event->above);
+    if (sibling == NULL || !sibling->stacked || _event->above != get_stacking_window(sibling))
+    {
+        invalidate_portal_stack();
+        return;
+    }
+
+    // Place the portal directly above its sibling.
+    if (sibling == portal || portal->stack_below == sibling) return;
+    unlink_portal(portal);
+    link_portal_above(portal, sibling);
+}
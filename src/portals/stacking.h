@@ -0,0 +1,48 @@
+#pragma once
+#include "../all.h"
+
+/**
+ * Adds a portal to the top of the stacking order, where newly created
+ * windows are placed by the X server.
+ *
+ * @param portal The portal to add.
+ */
+void add_portal_to_stack(Portal *portal);
+
+/**
+ * Removes a portal from the stacking order.
+ *
+ * @param portal The portal to remove.
+ */
+void remove_portal_from_stack(Portal *portal);
+
+/**
+ * Moves a portal to the top of the stacking order, mirroring a raise of its
+ * window.
+ *
+ * @param portal The portal to move.
+ */
+void move_portal_to_stack_top(Portal *portal);
+
+/**
+ * Marks the stacking order as diverged from the X server, so it gets
+ * reconciled the next time it is needed.
+ */
+void invalidate_portal_stack();
+
+/**
+ * Reconciles the stacking order with the X server, using a single query of
+ * the children of the root window.
+ */
+void reconcile_portal_stack();
+
+/**
+ * Retrieves the array of portal pointers in stacking order (bottom to top).
+ *
+ * @param out_count Pointer to store the number of portals.
+ *
+ * @return The stacked portal pointer array.
+ *
+ * @note Reconciles the stacking order first, if it has been invalidated.
+ */
+Portal **get_stacked_portals(unsigned int *out_count);
@@ -55,6 +55,8 @@ HANDLE(PropertyNotify)
     if (x_get_window_name(display, portal->client_window, title, sizeof(title)) == 0)
     {
         set_portal_title(portal, title);
-        draw_portal_frame(portal);
+
+        // Redraw the frame, if the portal has one.
+        if (portal->frame_window != None) draw_portal_frame(portal);
     }
 }
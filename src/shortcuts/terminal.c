@@ -4,19 +4,18 @@ static char terminal_command[CFG_MAX_VALUE_LENGTH];
 
 static void handle_terminal_shortcut()
 {
+    // The child process is reaped by the event loop once it terminates.
     pid_t pid = fork();
 
-    // The code below will only execute in the parent process.
-    if (pid > 0)
-    {
-        // Ignore the child process termination signal. By doing so, we ensure
-        // that the child process will be reaped by the system when it exits.
-        signal(SIGCHLD, SIG_IGN);
-    }
-
     // The code below will only execute in the forked child process.
     if (pid == 0)
     {
+        // Unblock the signals blocked by the event loop, as the signal mask
+        // would otherwise be inherited by the terminal.
+        sigset_t signal_mask;
+        sigemptyset(&signal_mask);
+        sigprocmask(SIG_SETMASK, &signal_mask, NULL);
+
         // Replace the current process with the terminal.
         char** args = split_string(terminal_command, " ", NULL);
         if (args == NULL) _exit(EXIT_FAILURE);
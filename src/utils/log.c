@@ -15,4 +15,8 @@ void log_message(const char* severity, const char* file, int line, const char* m
     va_end(vargs);
 
     printf("[%s][%s:%d] %s: %s\n", time_string, file, line, severity, formatted_message);
+
+    // Flush right away, as stdout is fully buffered when redirected to a file
+    // or a pipe.
+    fflush(stdout);
 }
@@ -80,6 +80,13 @@ unsigned int string_to_id(const char *string)
     return id % (1 << 16);
 }
 
+uint64_t get_monotonic_time()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
 int framerate_to_throttle_ms(int framerate)
 {
     if (framerate <= 0) return 1;
@@ -56,6 +56,14 @@ char** split_string(const char* string, const char* delimiter, int* out_count);
  */
 unsigned int string_to_id(const char *string);
 
+/**
+ * Retrieves the time of the monotonic clock, which is not affected by changes
+ * to the system time.
+ *
+ * @return The monotonic time in nanoseconds.
+ */
+uint64_t get_monotonic_time();
+
 /**
  * Converts a framerate to a throttle time in milliseconds.
  * 
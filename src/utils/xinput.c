@@ -19,20 +19,3 @@ int xi_select_input(Display *display, Window window, long mask)
     // Convert XInput2 success value (1) to standard convention (0).
     return status == 1 ? 0 : -1;
 }
-
-int xi_get_device_type(Display *display, int device_id, int *out_device_type)
-{
-    int num_devices;
-    XIDeviceInfo *devices = XIQueryDevice(display, device_id, &num_devices);
-    if (devices == NULL)
-    {
-        XIFreeDeviceInfo(devices);
-        return -1;
-    }
-    else
-    {
-        *out_device_type = devices->use;
-        XIFreeDeviceInfo(devices);
-        return 0;
-    }
-}
@@ -15,15 +15,3 @@
  * @note - The function is designed to mimic the `XSelectInput()` function.
  */
 int xi_select_input(Display *display, Window window, long mask);
-
-/**
- * Retrieves the type of a given XInput2 device.
- * 
- * @param display The X11 display.
- * @param device_id The ID of the XInput2 device.
- * @param out_device_type The output parameter to store the device type.
- * 
- * @return - `0` - Execution was successful.
- * @return - `-1` - Internal `XIQueryDevice()` call failed.
- */
-int xi_get_device_type(Display *display, int device_id, int *out_device_type);
@@ -1,7 +1,19 @@
 #include "../all.h"
 
+/** The number of ignored request sequences remembered at once. */
+#define X_IGNORED_SEQUENCE_COUNT 64
+
+typedef struct {
+    unsigned long first_serial;
+    unsigned long last_serial;
+} XIgnoredSequence;
+
 static Display *default_display = NULL;
 
+static XIgnoredSequence ignored_sequences[X_IGNORED_SEQUENCE_COUNT];
+static unsigned int ignored_sequence_index = 0;
+static unsigned long ignored_sequence_first_serial = 0;
+
 void x_set_default_display(Display *display)
 {
     default_display = display;
@@ -12,11 +24,37 @@ Display *x_get_default_display()
     return default_display;
 }
 
-Time x_get_current_time()
+void x_begin_ignoring_errors(Display *display)
+{
+    ignored_sequence_first_serial = NextRequest(display);
+}
+
+void x_end_ignoring_errors(Display *display)
 {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    return (now.tv_sec * 1000) + (now.tv_usec / 1000);
+    // Ensure at least one request was made during the sequence.
+    unsigned long next_serial = NextRequest(display);
+    if (next_serial == ignored_sequence_first_serial) return;
+
+    // Remember the sequence, overwriting the oldest one. Errors arrive
+    // asynchronously, so sequences can't be forgotten once they end.
+    ignored_sequences[ignored_sequence_index] = (XIgnoredSequence){
+        .first_serial = ignored_sequence_first_serial,
+        .last_serial = next_serial - 1
+    };
+    ignored_sequence_index = (ignored_sequence_index + 1) % X_IGNORED_SEQUENCE_COUNT;
+}
+
+bool x_is_error_ignored(XErrorEvent *error)
+{
+    for (int i = 0; i < X_IGNORED_SEQUENCE_COUNT; i++)
+    {
+        if (error->serial >= ignored_sequences[i].first_serial &&
+            error->serial <= ignored_sequences[i].last_serial)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 pid_t x_get_window_pid(Display *display, Window window)
@@ -253,74 +291,6 @@ int x_key_names_to_symbols(char *names, const char delimiter, int *out_keys, int
     return status;
 }
 
-static int _x_query_tree_recursively(
-    Display *display,
-    Window parent,
-    Window **out_children,
-    unsigned int *out_children_count,
-    int *out_current_position
-)
-{
-    // Query the children of the parent.
-    Window *children = NULL;
-    unsigned int children_count = 0;
-    if (XQueryTree(display, parent, &(Window){0}, &(Window){0}, &children, &children_count) == 0)
-    {
-        // Removing this window from the out_children array, as the query 
-        // failed. This is most likely because the window was destroyed.
-        if (*out_children != NULL && *out_children_count > 0 && *out_current_position > 0)
-        {
-            (*out_current_position)--;
-            (*out_children_count)--;
-            (*out_children)[*out_current_position] = None;
-        }
-        return 0;
-    }
-
-    // Ensure we don't handle parents without children.
-    if (children_count == 0) return 0;
-
-    // Increase the output children count and reallocate memory for them.
-    *out_children_count += children_count;
-    Window *new_out_children = realloc(*out_children, (*out_children_count) * sizeof(Window));
-    if (new_out_children == NULL)
-    {
-        *out_children_count -= children_count;
-        XFree(children);
-        return -1;
-    }
-    *out_children = new_out_children;
-
-    // Iterate over each child from the tree query.
-    for (unsigned int i = 0; i < children_count; i++) {
-        // Insert this child into the children output.
-        (*out_children)[*out_current_position] = children[i];
-        (*out_current_position)++;
-
-        // Insert its children into the children output.
-        int status = _x_query_tree_recursively(display, children[i], out_children, out_children_count, out_current_position);
-        if (status != 0)
-        {
-            XFree(children);
-            return status;
-        }
-    }
-
-    XFree(children);
-    return 0;
-}
-
-int x_query_tree_recursively(Display *display, Window parent, Window **out_children, unsigned int *out_children_count)
-{
-    // Initialize the required variables.
-    *out_children = NULL;
-    *out_children_count = 0;
-    int current_position = 0;
-
-    // Recursively query the tree.
-    return _x_query_tree_recursively(display, parent, out_children, out_children_count, &current_position);
-}
-
 bool x_window_is_top_level(Display *display, Window window)
 {
     Window root_window = DefaultRootWindow(display);
@@ -477,6 +447,94 @@ bool x_window_wants_decorations_ewmh(Display *display, Atom window_type)
     return true;
 }
 
+int x_get_window_opaque_region(Display *display, Window window, XRectangle **out_rectangles, int *out_count)
+{
+    // Retrieve the `_NET_WM_OPAQUE_REGION` property from the window.
+    unsigned char *data = NULL;
+    unsigned long item_count = 0;
+    Atom _NET_WM_OPAQUE_REGION = XInternAtom(display, "_NET_WM_OPAQUE_REGION", False);
+    int status = XGetWindowProperty(
+        display,                // Display
+        window,                 // Window
+        _NET_WM_OPAQUE_REGION,  // Property
+        0, (~0L),               // Offset, length
+        False,                  // Delete
+        XA_CARDINAL,            // Type
+        &(Atom){0},             // Response type (unused)
+        &(int){0},              // Response format (unused)
+        &item_count,            // Item count
+        &(unsigned long){0},    // Bytes after (unused)
+        &data                   // Data
+    );
+    if (status != Success || data == NULL || item_count < 4)
+    {
+        if (data != NULL) XFree(data);
+        return -1;
+    }
+
+    // Allocate memory for the rectangles, each made up of four cardinals.
+    int rectangle_count = item_count / 4;
+    XRectangle *rectangles = malloc(rectangle_count * sizeof(XRectangle));
+    if (rectangles == NULL)
+    {
+        XFree(data);
+        return -1;
+    }
+
+    // Convert the cardinals (x, y, width, height) to rectangles.
+    long *cardinals = (long *)data;
+    for (int i = 0; i < rectangle_count; i++)
+    {
+        rectangles[i] = (XRectangle){
+            .x = cardinals[i * 4],
+            .y = cardinals[i * 4 + 1],
+            .width = cardinals[i * 4 + 2],
+            .height = cardinals[i * 4 + 3]
+        };
+    }
+
+    // Free the property data.
+    XFree(data);
+
+    *out_rectangles = rectangles;
+    *out_count = rectangle_count;
+    return 0;
+}
+
+unsigned long x_get_window_bypass_compositor(Display *display, Window window)
+{
+    // Retrieve the `_NET_WM_BYPASS_COMPOSITOR` property from the window.
+    unsigned char *data = NULL;
+    unsigned long item_count = 0;
+    Atom _NET_WM_BYPASS_COMPOSITOR = XInternAtom(display, "_NET_WM_BYPASS_COMPOSITOR", False);
+    int status = XGetWindowProperty(
+        display,                    // Display
+        window,                     // Window
+        _NET_WM_BYPASS_COMPOSITOR,  // Property
+        0, 1,                       // Offset, length
+        False,                      // Delete
+        XA_CARDINAL,                // Type
+        &(Atom){0},                 // Response type (unused)
+        &(int){0},                  // Response format (unused)
+        &item_count,                // Item count
+        &(unsigned long){0},        // Bytes after (unused)
+        &data                       // Data
+    );
+    if (status != Success || data == NULL || item_count != 1)
+    {
+        if (data != NULL) XFree(data);
+        return 0;
+    }
+
+    // Store the hint, so we can free the property data.
+    unsigned long bypass_compositor = *(unsigned long*)data;
+
+    // Free the property data.
+    XFree(data);
+
+    return bypass_compositor;
+}
+
 Atom x_get_window_type(Display *display, Window window)
 {
     Atom _NET_WM_WINDOW_TYPE = XInternAtom(display, "_NET_WM_WINDOW_TYPE", False);
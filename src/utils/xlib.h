@@ -30,11 +30,36 @@ void x_set_default_display(Display *display);
 Display *x_get_default_display();
 
 /**
- * Retrieves the current time.
- * 
- * @return - `Time` - The current time.
+ * Begins a sequence of requests whose errors should be ignored.
+ *
+ * Meant for requests that race against clients unmapping or destroying their
+ * windows, where failures are expected and handled by subsequent events.
+ *
+ * @param display The X11 display.
+ *
+ * @warning - Sequences must not be nested.
  */
-Time x_get_current_time();
+void x_begin_ignoring_errors(Display *display);
+
+/**
+ * Ends a sequence of requests started with `x_begin_ignoring_errors()`.
+ *
+ * @param display The X11 display.
+ */
+void x_end_ignoring_errors(Display *display);
+
+/**
+ * Checks if an error was caused by a request within an ignored sequence.
+ *
+ * @param error The error to check.
+ *
+ * @return - `true` - The error should be ignored.
+ * @return - `false` - The error should be handled.
+ *
+ * @note - Safe to call from within an X11 error handler, as it doesn't make
+ * any requests.
+ */
+bool x_is_error_ignored(XErrorEvent *error);
 
 /**
  * Retrieves the process ID of the X client that owns the window.
@@ -139,22 +164,6 @@ int x_key_name_to_symbol(const char *name, int *out_key);
  */
 int x_key_names_to_symbols(char *names, const char delimiter, int *out_keys, int keys_size);
 
-/**
- * Queries the children of a window recursively.
- * 
- * @param display The X11 display.
- * @param parent The parent window.
- * @param out_children The buffer where the children will be stored.
- * @param out_children_count The buffer where the children count will be stored.
- * 
- * @return - `0` - The query was completed succesfully.
- * @return - `-1` - The query failed, memory allocation error.
- * 
- * @warning - Recursive X server calls make this function slow and 
- * resource-intensive.
- */
-int x_query_tree_recursively(Display *display, Window parent, Window **out_children, unsigned int *out_children_count);
-
 /**
  * Checks if a window is a top-level window.
  * 
@@ -235,6 +244,39 @@ bool x_window_wants_decorations_motif(Display *display, Window window);
  */
 bool x_window_wants_decorations_ewmh(Display *display, Atom window_type);
 
+/**
+ * Retrieves the opaque region of a window from the _NET_WM_OPAQUE_REGION
+ * property.
+ *
+ * @param display The X11 display.
+ * @param window The window to query.
+ * @param out_rectangles Pointer to store the rectangles of the region,
+ * relative to the window.
+ * @param out_count Pointer to store the number of rectangles.
+ *
+ * @return - `0` - Success, the window has an opaque region.
+ * @return - `-1` - The window has no _NET_WM_OPAQUE_REGION property.
+ *
+ * @warning - The caller is responsible for freeing the rectangles.
+ */
+int x_get_window_opaque_region(Display *display, Window window, XRectangle **out_rectangles, int *out_count);
+
+/**
+ * Retrieves the compositor bypass hint of a window from the
+ * _NET_WM_BYPASS_COMPOSITOR property.
+ *
+ * @param display The X11 display.
+ * @param window The window to query.
+ *
+ * @return - `0` - The window has no preference.
+ * @return - `1` - The window requests the compositor to be bypassed.
+ * @return - `2` - The window requests the compositor not to be bypassed.
+ *
+ * @note - Windows without a _NET_WM_BYPASS_COMPOSITOR property have no
+ * preference.
+ */
+unsigned long x_get_window_bypass_compositor(Display *display, Window window);
+
 /**
  * Retrieves the window type from the _NET_WM_WINDOW_TYPE property.
  *